@@ -0,0 +1,805 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "binary.h"
+#include "binding.h"
+#include "document.h"
+#include "lazy.h"
+#include "mapped_file.h"
+#include "ndjson.h"
+#include "parallel.h"
+#include "query.h"
+#include "scanner.h"
+#include "serializer.h"
+#include "simpleJSON.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/*** allocation counting, every operator new of the process comes here ***/
+std::atomic<size_t> allocations{0}, allocated_bytes{0};
+
+/*
+ * [note]: the whole set of replaceable operators is replaced, plain, array,
+ * sized and over-aligned, malloc/free are only called behind these two out of
+ * line functions, so the compiler never sees operator delete freeing what it
+ * takes for an operator new pointer
+ */
+[[gnu::noinline]] void *counted_allocate(size_t size, size_t align) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  void *p;
+  if (align <= alignof(std::max_align_t))
+    p = std::malloc(size);
+  else
+#ifdef _WIN32
+    p = _aligned_malloc(size, align);
+#else
+    p = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+  if (!p) throw std::bad_alloc{};
+  return p;
+}
+
+[[gnu::noinline]] void counted_release(void *p, size_t align) noexcept {
+#ifdef _WIN32
+  if (align > alignof(std::max_align_t)) return _aligned_free(p);
+#endif
+  (void)align;
+  std::free(p);
+}
+
+void *operator new(size_t size) { return counted_allocate(size, 0); }
+void *operator new[](size_t size) { return counted_allocate(size, 0); }
+void *operator new(size_t size, std::align_val_t align) {
+  return counted_allocate(size, static_cast<size_t>(align));
+}
+void *operator new[](size_t size, std::align_val_t align) {
+  return counted_allocate(size, static_cast<size_t>(align));
+}
+void operator delete(void *p) noexcept { counted_release(p, 0); }
+void operator delete[](void *p) noexcept { counted_release(p, 0); }
+void operator delete(void *p, size_t) noexcept { counted_release(p, 0); }
+void operator delete[](void *p, size_t) noexcept { counted_release(p, 0); }
+void operator delete(void *p, std::align_val_t align) noexcept {
+  counted_release(p, static_cast<size_t>(align));
+}
+void operator delete[](void *p, std::align_val_t align) noexcept {
+  counted_release(p, static_cast<size_t>(align));
+}
+void operator delete(void *p, size_t, std::align_val_t align) noexcept {
+  counted_release(p, static_cast<size_t>(align));
+}
+void operator delete[](void *p, size_t, std::align_val_t align) noexcept {
+  counted_release(p, static_cast<size_t>(align));
+}
+
+size_t peak_rss_kb() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters);
+  return counters.PeakWorkingSetSize / 1024;
+#else
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;  // [note]: bytes on macOS, KB elsewhere
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+/*** the number path parse_detail used before scan_number, kept as baseline ***/
+std::pair<JSONObject, size_t> legacy_parse_number(std::string_view json) {
+  static thread_local const std::regex num_re{
+      R"([+-]?[0-9]+(\.[0-9]*)?([eE][+-]?[0-9]+)?)"};
+  std::cmatch match;
+  if (std::regex_search(json.begin(), json.end(), match, num_re)) {
+    std::string str = match.str();
+    size_t end_loc{};
+    try {
+      int i = std::stoi(str, &end_loc);
+      if (end_loc == str.size()) return {JSONObject{i}, str.size()};
+      double d = std::stod(str, &end_loc);
+      if (end_loc == str.size()) return {JSONObject{d}, str.size()};
+    } catch (const std::exception &) {
+    }
+  }
+  return {JSONObject{std::monostate{}}, 0};
+}
+
+std::vector<std::string> number_corpus(size_t count) {
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> kind(0, 3), small(-1000, 1000);
+  std::uniform_int_distribution<int> big(-2'000'000'000, 2'000'000'000);
+  std::uniform_real_distribution<double> real(-1e6, 1e6);
+  std::vector<std::string> corpus;
+  for (size_t i = 0; i < count; ++i) {
+    switch (kind(gen)) {
+      case 0:
+        corpus.push_back(std::to_string(small(gen)));
+        break;
+      case 1:
+        corpus.push_back(std::to_string(big(gen)));
+        break;
+      case 2:
+        corpus.push_back(std::to_string(real(gen)));
+        break;
+      default:
+        corpus.push_back(std::to_string(small(gen)) + "." +
+                         std::to_string(small(gen) & 0xff) + "e-" +
+                         std::to_string(small(gen) & 0x1f));
+        break;
+    }
+  }
+  return corpus;
+}
+
+// [note]: returns nanoseconds per call of fn over the whole corpus
+template <typename Fn>
+double measure(const std::vector<std::string> &corpus, int rounds, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r)
+    for (const auto &s : corpus) fn(s);
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (double(rounds) * corpus.size());
+}
+
+// [note]: sink keeps the optimizer from dropping the measured calls
+volatile size_t sink = 0;
+
+void bench_numbers() {
+  constexpr int rounds = 20;
+  auto corpus = number_corpus(50'000);
+  for (const auto &s : corpus) {
+    auto [legacy, legacy_eaten] = legacy_parse_number(s);
+    auto [result, eaten] = parse_detail(s);
+    if (!(legacy == result) || legacy_eaten != eaten)
+      std::cout << "mismatch on " << s << ": " << legacy << " vs " << result
+                << '\n';
+  }
+  double legacy_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + legacy_parse_number(s).second;
+  });
+  double scan_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + scan_number(s).eaten;
+  });
+  double parse_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + parse_detail(s).second;
+  });
+  std::cout << "numbers: " << corpus.size() << " x " << rounds << " rounds\n"
+            << "regex + stoi/stod:\t" << legacy_ns << " ns/number\n"
+            << "scan_number:\t\t" << scan_ns << " ns/number ("
+            << legacy_ns / scan_ns << "x)\n"
+            << "parse_detail:\t\t" << parse_ns << " ns/number ("
+            << legacy_ns / parse_ns << "x)\n";
+}
+
+// [note]: pretty-printed records with long string values, where whitespace
+// skipping and string scanning dominate
+std::string pretty_strings_doc(size_t records) {
+  std::string doc = "[\n";
+  for (size_t i = 0; i < records; ++i) {
+    doc += "        {\n            \"message\": \"";
+    for (size_t j = 0; j < 4 + i % 8; ++j)
+      doc += "the quick brown fox jumps over the lazy dog ";
+    doc += i % 5 ? "\",\n" : "\\n\",\n";
+    doc += "            \"level\":     \"info\"\n        }";
+    doc += i + 1 == records ? "\n" : ",\n";
+  }
+  return doc + "]";
+}
+
+void bench_scanning() {
+  constexpr int rounds = 20;
+  std::vector<std::string> corpus{pretty_strings_doc(2'000)};
+  double size_mb = corpus[0].size() / 1e6;
+  std::cout << "scanning: " << size_mb << " MB x " << rounds << " rounds\n";
+  for (auto [level, name] : {std::pair{ScanLevel::Scalar, "scalar"},
+                             std::pair{ScanLevel::SSE2, "sse2"},
+                             std::pair{ScanLevel::AVX2, "avx2"}}) {
+    if (!use_scan_level(level)) continue;
+    JSONDocument doc;
+    double ns = measure(corpus, rounds, [&](const std::string &s) {
+      sink = sink + doc.parse_view(s);
+    });
+    std::cout << name << ":\t\t" << size_mb * 1e9 / ns << " MB/s\n";
+  }
+  // restore the best kernels
+  use_scan_level(ScanLevel::AVX2) || use_scan_level(ScanLevel::SSE2);
+}
+
+// [note]: the same text as plain UTF-8 and as \u escapes, decoding the
+// escaped one used to be several times slower
+void bench_escapes() {
+  constexpr int rounds = 200, groups = 20'000;
+  // [note]: both end with one escape so both are decoded into the buffer
+  std::string plain = "\"", escaped = "\"";
+  for (int i = 0; i < groups; ++i) {
+    plain += "\xe6\x88\x91\xe7\x88\xb1\xe4\xbd\xa0\xf0\x9f\x98\x80 ";
+    escaped += "\\u6211\\u7231\\u4f60\\ud83d\\ude00 ";
+  }
+  std::vector<std::string> plain_corpus{plain + "\\n\""},
+      escaped_corpus{escaped + "\\n\""};
+  std::string buffer;
+  auto decode = [&](const std::string &s) {
+    sink = sink + scan_string(s, buffer).value.size();
+  };
+  double plain_ns = measure(plain_corpus, rounds, decode);
+  double escaped_ns = measure(escaped_corpus, rounds, decode);
+  std::cout << "escapes: " << groups * 4 << " characters x " << rounds
+            << " rounds\n"
+            << "UTF-8:\t\t" << plain_ns / 1e3 << " us/string\n"
+            << "\\u escaped:\t" << escaped_ns / 1e3 << " us/string, "
+            << (escaped_ns - plain_ns) / (groups * 5) << " ns/escape\n";
+}
+
+void bench_serialize() {
+  constexpr int rounds = 20;
+  JSONObject obj = parse(pretty_strings_doc(2'000));
+  std::string out;
+  serialize(obj, out);
+  double size_mb = out.size() / 1e6;
+  auto run = [&](auto fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return size_mb * rounds / elapsed.count();
+  };
+  double stream_mbs = run([&] {
+    std::ostringstream os;
+    os << obj;
+    sink = sink + os.str().size();
+  });
+  double writer_mbs = run([&] {
+    out.clear();
+    serialize(obj, out);
+    sink = sink + out.size();
+  });
+  std::cout << "serialize: " << size_mb << " MB x " << rounds << " rounds\n"
+            << "operator<<:\t" << stream_mbs << " MB/s\n"
+            << "serialize:\t" << writer_mbs << " MB/s ("
+            << writer_mbs / stream_mbs << "x)\n";
+}
+
+void bench_ndjson() {
+  constexpr int rounds = 5;
+  std::string lines;
+  JSONList records =
+      std::get<JSONList>(parse(pretty_strings_doc(20'000)).inner);
+  for (const auto &record : records) {
+    serialize(record, lines);
+    lines += '\n';
+  }
+  double size_mb = lines.size() / 1e6;
+  std::cout << "ndjson: " << records.size() << " records, " << size_mb
+            << " MB x " << rounds << " rounds\n";
+  double single_mbs = 0;
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned threads = 1; threads <= cores; threads *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+      sink = sink + parse_ndjson(lines, {threads, {}}).size();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double mbs = size_mb * rounds / elapsed.count();
+    if (threads == 1) single_mbs = mbs;
+    std::cout << threads << " threads:\t" << mbs << " MB/s ("
+              << mbs / single_mbs << "x)\n";
+  }
+}
+
+void bench_query() {
+  constexpr int rounds = 1'000'000;
+  JSONObject obj = parse(
+      R"({"id": 1, "user": {"name": "ingnaryk", "roles": ["admin", "dev"],
+          "email": "x@y.z", "age": 30, "active": true, "score": 9.5,
+          "city": "sh", "lang": "cpp", "tz": "+8"}})");
+  auto run = [&](auto fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) fn();
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds;
+  };
+  double chain_ns = run([&] {
+    const auto &user =
+        std::get<JSONDict>(obj.inner).at(JSONObject{std::string{"user"}});
+    const auto &roles =
+        std::get<JSONDict>(user.inner).at(JSONObject{std::string{"roles"}});
+    sink = sink + std::get<JSONList>(roles.inner)[1].inner.index();
+  });
+  JSONPath path = *JSONPath::compile("$.user.roles[1]");
+  double path_ns = run([&] { sink = sink + path.find(obj)->inner.index(); });
+  std::cout << "query: " << rounds << " lookups\n"
+            << "std::get + at:\t" << chain_ns << " ns/lookup\n"
+            << "JSONPath:\t" << path_ns << " ns/lookup (" << chain_ns / path_ns
+            << "x)\n";
+}
+
+// [note]: decode the same trees from text and from the binary encoding
+void bench_binary() {
+  constexpr int rounds = 20;
+  std::string numbers = "[";
+  for (const auto &s : number_corpus(50'000)) numbers += s + ", ";
+  numbers += "0]";
+  for (auto [name, text] : {std::pair{"strings", pretty_strings_doc(2'000)},
+                            std::pair{"numbers", numbers}}) {
+    std::vector<std::string> corpus{text};
+    std::string bytes = encode_binary(parse(text));
+    std::vector<std::string> binary{bytes};
+    double parse_ns = measure(corpus, rounds, [&](const std::string &s) {
+      sink = sink + parse_detail(s).second;
+    });
+    double decode_ns = measure(binary, rounds, [&](const std::string &s) {
+      sink = sink + decode_binary_detail(s).second;
+    });
+    std::cout << "binary " << name << ": " << text.size() / 1e6 << " MB text, "
+              << bytes.size() / 1e6 << " MB binary\n"
+              << "parse:\t\t" << parse_ns / 1e6 << " ms\n"
+              << "decode_binary:\t" << decode_ns / 1e6 << " ms ("
+              << parse_ns / decode_ns << "x)\n";
+  }
+}
+
+// [note]: two fields read out of a large record
+void bench_lazy() {
+  constexpr int rounds = 200;
+  std::string record = R"({"payload": )" + pretty_strings_doc(500) +
+                       R"(, "id": 42, "user": {"name": "ingnaryk"}})";
+  std::vector<std::string> corpus{record};
+  double parse_ns = measure(corpus, rounds, [&](const std::string &s) {
+    JSONObject obj = parse(s);
+    const JSONDict &dict = std::get<JSONDict>(obj.inner);
+    sink = sink + std::get<int>(dict.at("id").inner) +
+           dict.at("user").inner.index();
+  });
+  double lazy_ns = measure(corpus, rounds, [&](const std::string &s) {
+    JSONCursor cursor{s};
+    sink = sink + std::get<int>(cursor["id"].decode().inner) +
+           cursor["user"]["name"].raw().size();
+  });
+  std::cout << "lazy: " << record.size() / 1e3 << " KB record, 2 fields\n"
+            << "parse:\t\t" << parse_ns / 1e3 << " us/record\n"
+            << "JSONCursor:\t" << lazy_ns / 1e3 << " us/record ("
+            << parse_ns / lazy_ns << "x)\n";
+}
+
+void bench_validate() {
+  constexpr int rounds = 20;
+  std::vector<std::string> corpus{pretty_strings_doc(2'000)};
+  double size_mb = corpus[0].size() / 1e6;
+  double lenient_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + parse_detail(s).second;
+  });
+  double strict_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + parse_detail<StrictPolicy>(s).second;
+  });
+  double validate_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + validate(s).ok();
+  });
+  std::cout << "validate: " << size_mb << " MB x " << rounds << " rounds\n"
+            << "parse_detail:\t" << size_mb * 1e9 / lenient_ns << " MB/s\n"
+            << "strict:\t\t" << size_mb * 1e9 / strict_ns << " MB/s\n"
+            << "validate:\t" << size_mb * 1e9 / validate_ns << " MB/s\n";
+}
+
+struct LogRecord {
+  std::string message, level;
+};
+JSON_FIELDS(LogRecord, message, level)
+
+void bench_binding() {
+  constexpr int rounds = 20;
+  std::vector<std::string> corpus{pretty_strings_doc(2'000)};
+  double size_mb = corpus[0].size() / 1e6;
+  // [note]: what binding replaces, a tree copied field by field
+  double tree_ns = measure(corpus, rounds, [&](const std::string &s) {
+    JSONObject tree = parse(s);
+    std::vector<LogRecord> records;
+    for (const auto &element : std::get<JSONList>(tree.inner)) {
+      const JSONDict &dict = std::get<JSONDict>(element.inner);
+      records.push_back({std::get<std::string>(dict.at("message").inner),
+                         std::get<std::string>(dict.at("level").inner)});
+    }
+    sink = sink + records.size();
+  });
+  double bound_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + from_json<std::vector<LogRecord>>(s)->size();
+  });
+  auto records = from_json<std::vector<LogRecord>>(corpus[0]);
+  double out_mb = to_json(*records).size() / 1e6;
+  double write_ns = measure(corpus, rounds, [&](const std::string &) {
+    sink = sink + to_json(*records).size();
+  });
+  std::cout << "binding: " << size_mb << " MB x " << rounds << " rounds\n"
+            << "parse + copy:\t" << size_mb * 1e9 / tree_ns << " MB/s\n"
+            << "from_json:\t" << size_mb * 1e9 / bound_ns << " MB/s ("
+            << tree_ns / bound_ns << "x)\n"
+            << "to_json:\t" << out_mb * 1e9 / write_ns << " MB/s\n";
+}
+
+// [note]: small records repeating the same keys, the case interning is for
+void bench_keys() {
+  constexpr int rounds = 20;
+  std::string text = "[";
+  for (int i = 0; i < 50'000; ++i)
+    text += R"({"request_id": )" + std::to_string(i) +
+            R"(, "user_name": "u", "status_code": 200, "request_path": "/",)"
+            R"( "duration_ms": 1.5, "cache_status": "hit"}, )";
+  text += "{}]";
+  std::vector<std::string> corpus{text};
+  double size_mb = text.size() / 1e6;
+  JSONDocument doc;
+  double plain_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + doc.parse(s);
+  });
+  size_t plain_bytes = doc.arena().capacity();
+  JSONKeyTable table;
+  ParseOptions options;
+  options.keys = &table;
+  double interned_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + doc.parse(s, options);
+  });
+  size_t interned_bytes = doc.arena().capacity() + table.capacity();
+  JSONNodeList records = get<JSONNodeList>(doc.root());
+  std::vector<std::string> lookups{"cache_status"};
+  double text_ns = measure(lookups, rounds, [&](const std::string &key) {
+    for (const JSONNode &record : records)
+      sink = sink + (get<JSONNodeDict>(record).find(key) != nullptr);
+  });
+  const JSONKey &key = *table.find("cache_status");
+  double key_ns = measure(lookups, rounds, [&](const std::string &) {
+    for (const JSONNode &record : records)
+      sink = sink + (get<JSONNodeDict>(record).find(key) != nullptr);
+  });
+  std::cout << "keys: " << size_mb << " MB x " << rounds << " rounds, "
+            << table.size() << " distinct keys\n"
+            << "parse:\t\t" << size_mb * 1e9 / plain_ns << " MB/s, "
+            << plain_bytes / 1e6 << " MB\n"
+            << "interned:\t" << size_mb * 1e9 / interned_ns << " MB/s, "
+            << interned_bytes / 1e6 << " MB\n"
+            << "find(text):\t" << text_ns / records.size() << " ns/record\n"
+            << "find(JSONKey):\t" << key_ns / records.size()
+            << " ns/record (" << text_ns / key_ns << "x)\n";
+}
+
+// [note]: a large subtree embedded twice, as a key and as a value
+void bench_shared() {
+  constexpr int rounds = 200;
+  JSONObject tree = parse(pretty_strings_doc(2'000));
+  std::vector<std::string> corpus{""};
+  auto embed = [&](const JSONObject &subtree) {
+    JSONDict dict;
+    dict.insert_or_assign(subtree, JSONObject{1});
+    dict.insert_or_assign(JSONObject{std::string{"copy"}}, subtree);
+    sink = sink + dict.size();
+  };
+  double copy_ns =
+      measure(corpus, rounds, [&](const std::string &) { embed(tree); });
+  JSONObject shared = share(tree);
+  double shared_ns =
+      measure(corpus, rounds, [&](const std::string &) { embed(shared); });
+  std::cout << "shared: 2000 records embedded twice\n"
+            << "deep copy:\t" << copy_ns / 1e3 << " us\n"
+            << "share:\t\t" << shared_ns / 1e3 << " us (" << copy_ns / shared_ns
+            << "x)\n";
+}
+
+// [note]: a response cache keyed by request payloads, looked up again and again
+void bench_hashing() {
+  constexpr int rounds = 20;
+  std::vector<JSONObject> payloads, shared_payloads;
+  for (int i = 0; i < 1'000; ++i) {
+    payloads.push_back(parse(R"({"query": {"user": ")" + std::to_string(i) +
+                             R"(", "filters": ["a", "b", "c"], "page": 1},)"
+                             R"( "fields": ["id", "name", "email"]})"));
+    shared_payloads.push_back(share(payloads.back()));
+  }
+  std::vector<std::string> corpus{""};
+  auto lookups = [&](const std::vector<JSONObject> &keys) {
+    std::unordered_map<JSONObject, size_t, JSONObjectHash> cache;
+    for (size_t i = 0; i < keys.size(); ++i) cache.emplace(keys[i], i);
+    return measure(corpus, rounds, [&](const std::string &) {
+      for (const auto &key : keys) sink = sink + cache.find(key)->second;
+    });
+  };
+  double plain_ns = lookups(payloads), shared_ns = lookups(shared_payloads);
+  std::cout << "hashing: " << payloads.size() << " payloads x " << rounds
+            << " rounds\n"
+            << "plain keys:\t" << plain_ns / payloads.size() << " ns/lookup\n"
+            << "shared keys:\t" << shared_ns / payloads.size()
+            << " ns/lookup (" << plain_ns / shared_ns << "x)\n";
+}
+
+// [note]: speedups only show on a machine with that many cores
+void bench_parallel() {
+  constexpr int rounds = 5;
+  std::vector<std::string> corpus{pretty_strings_doc(20'000)};
+  double size_mb = corpus[0].size() / 1e6;
+  double sequential_ns = measure(corpus, rounds, [&](const std::string &s) {
+    sink = sink + parse_detail(s).second;
+  });
+  std::cout << "parallel: " << size_mb << " MB x " << rounds << " rounds, "
+            << std::thread::hardware_concurrency() << " cores\n"
+            << "parse_detail:\t" << size_mb * 1e9 / sequential_ns << " MB/s\n";
+  for (unsigned threads : {2u, 4u, 8u, 16u}) {
+    ParallelOptions options;
+    options.threads = threads;
+    double ns = measure(corpus, rounds, [&](const std::string &s) {
+      sink = sink + parse_parallel_detail(s, options).second;
+    });
+    std::cout << threads << " threads:\t" << size_mb * 1e9 / ns << " MB/s ("
+              << sequential_ns / ns << "x)\n";
+  }
+}
+
+// [note]: a worker's stream of small same-shaped requests, where allocator
+// churn is most of the cost
+void bench_parser() {
+  constexpr int rounds = 5;
+  std::vector<std::string> corpus;
+  for (int i = 0; i < 20'000; ++i)
+    corpus.push_back(R"({"request_id": )" + std::to_string(i) +
+                     R"(, "user": {"name": "u\u00e9", "roles": ["a", "b"]},)"
+                     R"( "path": "/items/)" + std::to_string(i % 97) +
+                     R"(", "params": [1, 2.5, true, null], "note": "x\ny"})");
+  auto run = [&](auto &&parse_one) {
+    size_t before = allocations.load();
+    double ns = measure(corpus, rounds, parse_one);
+    double per_doc = double(allocations.load() - before) / rounds /
+                     corpus.size();
+    return std::pair{ns, per_doc};
+  };
+  auto [tree_ns, tree_allocs] = run([&](const std::string &s) {
+    sink = sink + parse_detail(s).second;
+  });
+  auto [fresh_ns, fresh_allocs] = run([&](const std::string &s) {
+    JSONDocument doc;
+    sink = sink + doc.parse(s);
+  });
+  JSONDocument doc;
+  auto [reused_ns, reused_allocs] = run([&](const std::string &s) {
+    sink = sink + doc.parse(s);
+  });
+  JSONParser parser;
+  auto [parser_ns, parser_allocs] = run([&](const std::string &s) {
+    sink = sink + parser.parse(s);
+  });
+  std::cout << "parser: " << corpus.size() << " records of "
+            << corpus[0].size() << " bytes x " << rounds << " rounds\n"
+            << "parse_detail:\t" << tree_ns << " ns/doc, " << tree_allocs
+            << " allocs/doc\n"
+            << "JSONDocument:\t" << fresh_ns << " ns/doc, " << fresh_allocs
+            << " allocs/doc\n"
+            << "reused:\t\t" << reused_ns << " ns/doc, " << reused_allocs
+            << " allocs/doc\n"
+            << "JSONParser:\t" << parser_ns << " ns/doc ("
+            << tree_ns / parser_ns << "x), " << parser_allocs
+            << " allocs/doc, " << parser.usage().total() / 1e3
+            << " KB held\n";
+}
+
+/*** corpus harness ***/
+struct Corpus {
+  std::string name;
+  std::string text;
+  bool ndjson = false;  // one record per line, parsed by parse_ndjson
+};
+
+std::vector<Corpus> generated_corpora() {
+  std::vector<Corpus> corpora;
+  std::string numbers = "[";
+  for (const auto &s : number_corpus(200'000)) numbers += s + ", ";
+  corpora.push_back({"numbers", numbers + "0]"});
+  std::string strings = "[";
+  for (int i = 0; i < 5'000; ++i) {
+    strings += R"("line \"one\"\n\tpath C:\\temp\\)" + std::to_string(i) +
+               R"( caf\u00e9 \u6211 )";
+    for (int j = 0; j < i % 16; ++j) strings += "lorem ipsum dolor sit amet ";
+    strings += "\",\n ";
+  }
+  corpora.push_back({"strings", strings + "\"\"]"});
+  std::string deep = "[";
+  for (int i = 0; i < 2'000; ++i) {
+    for (int d = 0; d < 64; ++d) deep += R"({"k": [)";
+    deep += std::to_string(i);
+    for (int d = 0; d < 64; ++d) deep += "]}";
+    deep += ", ";
+  }
+  corpora.push_back({"deep", deep + "null]"});
+  std::string wide = "{";
+  for (int i = 0; i < 100'000; ++i)
+    wide += "\"field_" + std::to_string(i) + "\": " + std::to_string(i) + ", ";
+  corpora.push_back({"wide", wide + "\"end\": true}"});
+  std::string logs;
+  for (int i = 0; i < 50'000; ++i)
+    logs += R"({"ts": )" + std::to_string(1'700'000'000 + i) +
+            R"(, "level": ")" + (i % 10 ? "info" : "error") +
+            R"(", "latency": )" + std::to_string(i % 997 / 10.0) +
+            R"(, "msg": "request served", "tags": ["api", "v2"]})" + "\n";
+  corpora.push_back({"ndjson", logs, true});
+  return corpora;
+}
+
+// [note]: counts every event, keys included, as the values of a document
+struct ValueCounter : JSONHandler {
+  size_t values = 0;
+  void on_null() { ++values; }
+  void on_bool(bool) { ++values; }
+  void on_int(int) { ++values; }
+  void on_double(double) { ++values; }
+  void on_string(std::string_view) { ++values; }
+  void on_key(std::string_view) { ++values; }
+  void start_array() { ++values; }
+  void start_object() { ++values; }
+};
+
+// [note]: per run over the whole corpus
+struct Result {
+  double ns = 0;
+  double allocs = 0, alloc_bytes = 0;
+};
+
+// [note]: repeats fn for about 0.2s after a warm-up run
+template <typename Fn>
+Result run_rounds(Fn fn) {
+  fn();
+  Result result;
+  size_t rounds = 0, allocs = allocations, bytes = allocated_bytes;
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed{};
+  while (rounds < 3 || elapsed.count() < 0.2) {
+    fn();
+    ++rounds;
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  result.ns = elapsed.count() * 1e9 / rounds;
+  result.allocs = double(allocations - allocs) / rounds;
+  result.alloc_bytes = double(allocated_bytes - bytes) / rounds;
+  return result;
+}
+
+void bench_corpus(const Corpus &corpus, bool machine) {
+  auto parse_text = [&](std::string_view text) {
+    if (!corpus.ndjson) return parse(text);
+    JSONList list;
+    for (auto &record : parse_ndjson(text, {1, {}}))
+      list.push_back(std::move(record.value));
+    return JSONObject{std::move(list)};
+  };
+  auto serialize_tree = [&](const JSONObject &obj, std::string &out) {
+    if (!corpus.ndjson) return serialize(obj, out);
+    for (const auto &record : std::get<JSONList>(obj.inner)) {
+      serialize(record, out);
+      out += '\n';
+    }
+  };
+  if (!corpus.ndjson && parse_detail(corpus.text).second == 0)
+    std::cerr << corpus.name << ": not a valid document\n";
+  JSONObject obj = parse_text(corpus.text);
+  std::string out;
+  serialize_tree(obj, out);
+  ValueCounter counter;
+  parse_sax(serialize(obj), counter);
+  if (corpus.ndjson) --counter.values;  // the list holding the records
+  const size_t docs =
+      corpus.ndjson ? std::get<JSONList>(obj.inner).size() : 1;
+
+  std::pair<const char *, Result> results[] = {
+      {"parse", run_rounds([&] {
+         sink = sink + parse_text(corpus.text).inner.index();
+       })},
+      {"serialize", run_rounds([&] {
+         out.clear();
+         serialize_tree(obj, out);
+         sink = sink + out.size();
+       })},
+      {"roundtrip", run_rounds([&] {
+         std::string text;
+         serialize_tree(parse_text(corpus.text), text);
+         sink = sink + text.size();
+       })},
+  };
+  for (const auto &[op, result] : results) {
+    const size_t bytes = op[0] == 's' ? out.size() : corpus.text.size();
+    const double mbs = bytes / 1e6 * 1e9 / result.ns;
+    const double ns_value = result.ns / std::max<size_t>(counter.values, 1);
+    const double allocs = result.allocs / std::max<size_t>(docs, 1);
+    if (machine) {
+      JSONDict line;
+      auto field = [&](const char *key, JSONObject value) {
+        line.insert_or_assign(JSONObject{std::string{key}}, std::move(value));
+      };
+      field("corpus", JSONObject{corpus.name});
+      field("op", JSONObject{std::string{op}});
+      field("bytes", JSONObject{static_cast<double>(bytes)});
+      field("values", JSONObject{static_cast<int>(counter.values)});
+      field("mb_per_s", JSONObject{mbs});
+      field("ns_per_value", JSONObject{ns_value});
+      field("allocs_per_doc", JSONObject{allocs});
+      field("alloc_bytes_per_doc",
+            JSONObject{result.alloc_bytes / std::max<size_t>(docs, 1)});
+      field("peak_rss_kb", JSONObject{static_cast<int>(peak_rss_kb())});
+      std::cout << serialize(JSONObject{std::move(line)}) << '\n';
+    } else {
+      std::cout << corpus.name << '\t' << op << '\t' << mbs << " MB/s\t"
+                << ns_value << " ns/value\t" << allocs << " allocs/doc\t"
+                << peak_rss_kb() / 1024 << " MB peak RSS\n";
+    }
+  }
+}
+
+/*
+ * [note]: usage: bench [--json] [file...]
+ * without files, the micro benchmarks run and then the generated corpora
+ * (numbers, escaped strings, deep nesting, a wide dict, NDJSON logs), files
+ * replace the generated corpora, a .ndjson/.jsonl file is read line by line
+ * --json prints one JSON object per corpus and operation instead of the text
+ * report, so the output of two commits can be compared by a script
+ */
+int main(int argc, char *argv[]) {
+  bool machine = false;
+  std::vector<Corpus> corpora;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--json") {
+      machine = true;
+      continue;
+    }
+    MappedFile file;
+    if (!file.open(arg)) {
+      std::cerr << "cannot read " << arg << '\n';
+      return 1;
+    }
+    auto ends_with = [&](std::string_view suffix) {
+      return arg.size() >= suffix.size() &&
+             arg.compare(arg.size() - suffix.size(), suffix.size(), suffix) ==
+                 0;
+    };
+    corpora.push_back({arg, std::string{file.view()},
+                       ends_with(".ndjson") || ends_with(".jsonl")});
+  }
+  if (corpora.empty()) {
+    if (!machine) {
+      bench_numbers();
+      bench_scanning();
+      bench_escapes();
+      bench_serialize();
+      bench_ndjson();
+      bench_query();
+      bench_lazy();
+      bench_binary();
+      bench_validate();
+      bench_binding();
+      bench_keys();
+      bench_shared();
+      bench_hashing();
+      bench_parallel();
+      bench_parser();
+    }
+    corpora = generated_corpora();
+  }
+  for (const auto &corpus : corpora) bench_corpus(corpus, machine);
+}
\ No newline at end of file
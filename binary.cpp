@@ -0,0 +1,245 @@
+#include "binary.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <variant>
+
+#include "type.h"
+
+enum class BinaryTag : char {
+  Null,
+  False,
+  True,
+  Int,
+  Double,
+  String,
+  List,
+  Dict
+};
+
+static void write_varint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out += static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+static void write_fixed(std::string &out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) out += static_cast<char>(value >> (8 * i));
+}
+
+static void patch_fixed32(std::string &out, size_t at, uint32_t value) {
+  for (int i = 0; i < 4; ++i) out[at + i] = static_cast<char>(value >> (8 * i));
+}
+
+// [note]: false as soon as a container body is longer than max_body
+static bool encode(const JSONObject &obj, std::string &out, size_t max_body) {
+  // [note]: containers reserve their body length and patch it once written
+  auto open = [&](BinaryTag tag, size_t count) {
+    out += static_cast<char>(tag);
+    write_varint(out, count);
+    write_fixed(out, 0, 4);
+    return out.size();
+  };
+  auto close = [&](size_t body) {
+    if (out.size() - body > max_body) return false;
+    patch_fixed32(out, body - 4, static_cast<uint32_t>(out.size() - body));
+    return true;
+  };
+  return std::visit(
+      overloaded{
+          [&](std::monostate) {
+            out += static_cast<char>(BinaryTag::Null);
+            return true;
+          },
+          [&](bool b) {
+            out += static_cast<char>(b ? BinaryTag::True : BinaryTag::False);
+            return true;
+          },
+          [&](int i) {
+            out += static_cast<char>(BinaryTag::Int);
+            uint32_t u = static_cast<uint32_t>(i);
+            write_varint(out, (u << 1) ^ (i < 0 ? ~0u : 0u));
+            return true;
+          },
+          [&](double d) {
+            out += static_cast<char>(BinaryTag::Double);
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof bits);
+            write_fixed(out, bits, 8);
+            return true;
+          },
+          [&](const std::string &s) {
+            out += static_cast<char>(BinaryTag::String);
+            write_varint(out, s.size());
+            out += s;
+            return true;
+          },
+          [&](const JSONList &list) {
+            size_t body = open(BinaryTag::List, list.size());
+            for (const auto &element : list)
+              if (!encode(element, out, max_body)) return false;
+            return close(body);
+          },
+          [&](const JSONDict &dict) {
+            size_t body = open(BinaryTag::Dict, dict.size());
+            for (const auto &[key, value] : dict)
+              if (!encode(key, out, max_body) ||
+                  !encode(value, out, max_body))
+                return false;
+            return close(body);
+          },
+          [&](const JSONShared &shared) {
+            return encode(shared->value, out, max_body);
+          },
+      },
+      obj.inner);
+}
+
+bool encode_binary(const JSONObject &obj, std::string &out, size_t max_body) {
+  const size_t start = out.size();
+  if (encode(obj, out, std::min<size_t>(max_body, UINT32_MAX))) return true;
+  out.resize(start);
+  return false;
+}
+
+std::string encode_binary(const JSONObject &obj, size_t max_body) {
+  std::string out;
+  encode_binary(obj, out, max_body);
+  return out;
+}
+
+// [note]: bounds checked reading, any overrun makes `ok` false for good
+struct BinaryReader {
+  std::string_view bytes;
+  size_t pos = 0;
+  bool ok = true;
+
+  bool has(size_t n) {
+    ok = ok && n <= bytes.size() - pos;
+    return ok;
+  }
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64 && has(1); shift += 7) {
+      unsigned char c = bytes[pos++];
+      value |= uint64_t{c & 0x7fu} << shift;
+      if (c < 0x80) return value;
+    }
+    ok = false;
+    return 0;
+  }
+  uint64_t fixed(int n) {
+    if (!has(n)) return 0;
+    uint64_t value = 0;
+    for (int i = 0; i < n; ++i)
+      value |= uint64_t{static_cast<unsigned char>(bytes[pos++])} << (8 * i);
+    return value;
+  }
+  // [note]: count and body length of a container, the body must fit and hold
+  // at least a byte per value before anything is reserved
+  std::pair<size_t, size_t> header(size_t per_entry) {
+    uint64_t count = varint();
+    uint64_t body = fixed(4);
+    ok = ok && has(body) && count <= body / per_entry;
+    return {ok ? count : 0, ok ? body : 0};
+  }
+
+  JSONObject value(size_t depth, const ParseOptions &options) {
+    if (!has(1)) return {};
+    switch (static_cast<BinaryTag>(bytes[pos++])) {
+      case BinaryTag::Null:
+        return JSONObject{std::monostate{}};
+      case BinaryTag::False:
+        return JSONObject{false};
+      case BinaryTag::True:
+        return JSONObject{true};
+      case BinaryTag::Int: {
+        uint64_t u = varint();
+        ok = ok && u <= UINT32_MAX;
+        auto zigzag = static_cast<uint32_t>(u);
+        return JSONObject{
+            static_cast<int>((zigzag >> 1) ^ (0u - (zigzag & 1)))};
+      }
+      case BinaryTag::Double: {
+        uint64_t bits = fixed(8);
+        double d;
+        std::memcpy(&d, &bits, sizeof d);
+        return JSONObject{d};
+      }
+      case BinaryTag::String: {
+        uint64_t size = varint();
+        if (!has(size)) return {};
+        std::string s{bytes.substr(pos, size)};
+        pos += size;
+        return JSONObject{std::move(s)};
+      }
+      case BinaryTag::List: {
+        auto [count, body] = header(1);
+        ok = ok && depth < options.max_depth;
+        JSONList list;
+        list.reserve(count);
+        const size_t end = pos + body;
+        for (size_t i = 0; ok && i < count; ++i)
+          list.push_back(value(depth + 1, options));
+        ok = ok && pos == end;
+        return JSONObject{std::move(list)};
+      }
+      case BinaryTag::Dict: {
+        auto [count, body] = header(2);
+        ok = ok && depth < options.max_depth;
+        JSONDict dict;
+        dict.reserve(count);
+        const size_t end = pos + body;
+        for (size_t i = 0; ok && i < count; ++i) {
+          JSONObject key = value(depth + 1, options);
+          dict.insert_or_assign(std::move(key), value(depth + 1, options));
+        }
+        ok = ok && pos == end;
+        return JSONObject{std::move(dict)};
+      }
+    }
+    ok = false;
+    return {};
+  }
+};
+
+std::pair<JSONObject, size_t> decode_binary_detail(
+    std::string_view bytes, const ParseOptions &options) {
+  BinaryReader reader{bytes};
+  JSONObject obj = reader.value(0, options);
+  return {std::move(obj), reader.ok ? reader.pos : 0};
+}
+
+JSONObject decode_binary(std::string_view bytes, const ParseOptions &options) {
+  return decode_binary_detail(bytes, options).first;
+}
+
+size_t skip_binary(std::string_view bytes) {
+  BinaryReader reader{bytes};
+  if (!reader.has(1)) return 0;
+  switch (static_cast<BinaryTag>(bytes[reader.pos++])) {
+    case BinaryTag::Null:
+    case BinaryTag::False:
+    case BinaryTag::True:
+      break;
+    case BinaryTag::Int:
+      reader.varint();
+      break;
+    case BinaryTag::Double:
+      reader.fixed(8);
+      break;
+    case BinaryTag::String:
+      if (uint64_t size = reader.varint(); reader.has(size)) reader.pos += size;
+      break;
+    case BinaryTag::List:
+    case BinaryTag::Dict:
+      reader.pos += reader.header(1).second;
+      break;
+    default:
+      return 0;
+  }
+  return reader.ok ? reader.pos : 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "parser.h"
+#include "simpleJSON.h"
+
+/*
+ * [note]: a compact tagged binary format for JSONObject, one tag byte per
+ * value followed by
+ *   null false true     nothing
+ *   int                 zigzag varint
+ *   double              8 bytes IEEE 754, little endian
+ *   string              varint byte length, bytes
+ *   list dict           varint element/entry count, 4 bytes little endian body
+ *                       length, body (elements, or key value key value ...)
+ * the count lets decoding reserve a JSONList/JSONDict at once and the body
+ * length lets a reader jump over a whole container in O(1)
+ * a tree round-trips exactly, decode_binary(encode_binary(parse(json))) equals
+ * parse(json), a container is limited to 4GB of body
+ *
+ * a container whose body would be longer than max_body, never more than the
+ * 4GB the format can hold, fails the encoding: `out` is left as it was and
+ * false is returned, or an empty string, which no value encodes to
+ */
+bool encode_binary(const JSONObject &obj, std::string &out,
+                   size_t max_body = UINT32_MAX);
+std::string encode_binary(const JSONObject &obj,
+                          size_t max_body = UINT32_MAX);
+
+// [note]: like parse_detail, 0 eaten indicates malformed bytes, nesting is
+// bounded by options.max_depth
+std::pair<JSONObject, size_t> decode_binary_detail(
+    std::string_view bytes, const ParseOptions &options = {});
+JSONObject decode_binary(std::string_view bytes,
+                         const ParseOptions &options = {});
+
+// [note]: the size of the first value without decoding it, 0 if malformed
+size_t skip_binary(std::string_view bytes);
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "lazy.h"
+#include "parser.h"
+#include "scanner.h"
+#include "serializer.h"
+#include "simpleJSON.h"
+
+/*
+ * [note]: binds JSON to C++ types directly, from_json reads the text into the
+ * value and to_json writes the value through a JSONWriter, no JSONObject is
+ * built in between, supported types are
+ *   bool, integers, floating points, std::string, std::optional (null),
+ *   std::vector, std::map/std::unordered_map with std::string keys,
+ *   JSONObject (parsed as it is) and structs described by JSON_FIELDS
+ *
+ *   struct User {
+ *     std::string name;
+ *     int age = 0;
+ *     std::vector<std::string> roles;
+ *   };
+ *   JSON_FIELDS(User, name, age, roles)
+ *
+ *   std::optional<User> user = from_json<User>(R"({"name": "ingnaryk"})");
+ *   std::string text = to_json(*user);
+ *
+ * JSON_FIELDS goes at global scope after the struct and takes up to 64 fields,
+ * a field missing from the text keeps its value, an unknown key is skipped
+ * unparsed, and duplicate keys keep the last, the grammar is the lenient one
+ * of parse_sax
+ */
+
+// [note]: FNV-1a, field names are hashed at compile time, keys at runtime
+constexpr uint64_t json_key_hash(std::string_view key) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : key)
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  return hash;
+}
+
+template <typename Class, typename Member>
+struct JSONField {
+  std::string_view name;
+  Member Class::*member;
+  uint64_t hash;
+};
+
+template <typename Class, typename Member>
+constexpr JSONField<Class, Member> json_field(std::string_view name,
+                                              Member Class::*member) {
+  return {name, member, json_key_hash(name)};
+}
+
+// [note]: specialized by JSON_FIELDS with a constexpr tuple `fields`
+template <typename T>
+struct JSONFields;
+
+#define JSON_PARENS ()
+#define JSON_EXPAND(...) \
+  JSON_EXPAND3(JSON_EXPAND3(JSON_EXPAND3(JSON_EXPAND3(__VA_ARGS__))))
+#define JSON_EXPAND3(...) \
+  JSON_EXPAND2(JSON_EXPAND2(JSON_EXPAND2(JSON_EXPAND2(__VA_ARGS__))))
+#define JSON_EXPAND2(...) \
+  JSON_EXPAND1(JSON_EXPAND1(JSON_EXPAND1(JSON_EXPAND1(__VA_ARGS__))))
+#define JSON_EXPAND1(...) __VA_ARGS__
+// [note]: every rescan of JSON_EXPAND expands one more field, as a macro
+// can't call itself directly
+#define JSON_FIELD_LIST(Type, field, ...) \
+  json_field(#field, &Type::field),       \
+      __VA_OPT__(JSON_FIELD_AGAIN JSON_PARENS(Type, __VA_ARGS__))
+#define JSON_FIELD_AGAIN() JSON_FIELD_LIST
+
+#define JSON_FIELDS(Type, ...)                                       \
+  template <>                                                        \
+  struct JSONFields<Type> {                                          \
+    static constexpr auto fields =                                   \
+        std::tuple{JSON_EXPAND(JSON_FIELD_LIST(Type, __VA_ARGS__))}; \
+  };
+
+template <typename T, typename = void>
+struct is_json_bound : std::false_type {};
+template <typename T>
+struct is_json_bound<T, std::void_t<decltype(JSONFields<T>::fields)>>
+    : std::true_type {};
+
+template <typename T>
+struct is_json_vector : std::false_type {};
+template <typename T, typename Alloc>
+struct is_json_vector<std::vector<T, Alloc>> : std::true_type {};
+
+template <typename T>
+struct is_json_optional : std::false_type {};
+template <typename T>
+struct is_json_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct is_json_map : std::false_type {};
+template <typename T, typename... Rest>
+struct is_json_map<std::map<std::string, T, Rest...>> : std::true_type {};
+template <typename T, typename... Rest>
+struct is_json_map<std::unordered_map<std::string, T, Rest...>>
+    : std::true_type {};
+
+template <typename T>
+constexpr bool json_unsupported = false;
+
+/*
+ * [note]: a pull parser walking the text along the C++ type, one read() per
+ * value, nesting is bounded by ParseOptions::max_depth like parse_sax
+ */
+class JSONReader {
+ public:
+  JSONReader(std::string_view json, const ParseOptions &options)
+      : json{json}, options{options} {}
+
+  template <typename T>
+  bool read(T &value);
+  size_t position() const { return pos; }
+
+ private:
+  std::string_view json;
+  const ParseOptions &options;
+  size_t pos = 0, depth = 0;
+  std::string buffer;
+
+  bool fail(ParseErrorCode code) {
+    if (options.error) *options.error = locate_error(json, code, pos);
+    return false;
+  }
+  bool skip() {
+    pos = skip_spaces(json, pos);
+    return pos < json.size() || fail(ParseErrorCode::UnexpectedEnd);
+  }
+  NumberToken number() {
+    NumberToken num = scan_number(json.substr(pos));
+    if (!num.eaten) fail(ParseErrorCode::TypeMismatch);
+    return num;
+  }
+  // [note]: json[pos] opens the container, element() reads one element or
+  // entry
+  template <typename Element>
+  bool read_container(char close, Element element);
+  // [note]: entry(key) reads the value of a dict entry, key views `buffer`
+  template <typename Entry>
+  bool read_entries(Entry entry);
+  template <typename T>
+  bool read_field(T &value, std::string_view key);
+};
+
+template <typename T>
+bool JSONReader::read(T &value) {
+  if (!skip()) return false;
+  const char c = json[pos];
+  // [note]: an empty list element or dict value followed by ',' is null, as
+  // LenientPolicy has it, which only fits an optional or a JSONObject
+  if (depth > 0 && c == ',') {
+    if constexpr (is_json_optional<T>::value) {
+      value.reset();
+      return true;
+    } else if constexpr (std::is_same_v<T, JSONObject>) {
+      value = JSONObject{std::monostate{}};
+      return true;
+    } else {
+      return fail(ParseErrorCode::TypeMismatch);
+    }
+  }
+  if constexpr (std::is_same_v<T, bool>) {
+    if (json.compare(pos, 4, "true") == 0) {
+      value = true;
+      pos += 4;
+      return true;
+    }
+    if (json.compare(pos, 5, "false") == 0) {
+      value = false;
+      pos += 5;
+      return true;
+    }
+    return fail(ParseErrorCode::TypeMismatch);
+  } else if constexpr (std::is_integral_v<T>) {
+    // [note]: converted again as T, so 64-bit values keep every digit and a
+    // fraction, an exponent or an out of range value is a mismatch
+    NumberToken num = number();
+    if (!num.eaten) return false;
+    const char *first = json.data() + pos + (c == '+'),
+               *last = json.data() + pos + num.eaten;
+    auto [end, ec] = std::from_chars(first, last, value);
+    if (ec != std::errc{} || end != last)
+      return fail(ParseErrorCode::TypeMismatch);
+    pos += num.eaten;
+    return true;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    NumberToken num = number();
+    if (!num.eaten) return false;
+    value = static_cast<T>(num.is_int ? num.int_value : num.double_value);
+    pos += num.eaten;
+    return true;
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    if (c != '"' && c != '\'') return fail(ParseErrorCode::TypeMismatch);
+    StringToken str =
+        scan_string(json.substr(pos), buffer, options.escape_extensions);
+    if (!str.eaten) return fail(ParseErrorCode::UnterminatedString);
+    value.assign(str.value);
+    pos += str.eaten;
+    return true;
+  } else if constexpr (std::is_same_v<T, JSONObject>) {
+    ParseError error;
+    ParseOptions nested = options;
+    nested.max_depth = options.max_depth - depth;
+    nested.error = &error;
+    auto [obj, eaten] = parse_detail(json.substr(pos), nested);
+    if (!eaten) {
+      pos += error.offset;
+      return fail(error.code);
+    }
+    value = std::move(obj);
+    pos += eaten;
+    return true;
+  } else if constexpr (is_json_optional<T>::value) {
+    if (json.compare(pos, 4, "null") == 0) {
+      value.reset();
+      pos += 4;
+      return true;
+    }
+    return read(value.emplace());
+  } else if constexpr (is_json_vector<T>::value) {
+    if (c != '[') return fail(ParseErrorCode::TypeMismatch);
+    value.clear();
+    return read_container(']', [&] {
+      // [note]: not emplace_back(), std::vector<bool> has no references
+      typename T::value_type element{};
+      if (!read(element)) return false;
+      value.push_back(std::move(element));
+      return true;
+    });
+  } else if constexpr (is_json_map<T>::value) {
+    if (c != '{') return fail(ParseErrorCode::TypeMismatch);
+    value.clear();
+    return read_entries(
+        [&](std::string_view key) { return read(value[std::string{key}]); });
+  } else if constexpr (is_json_bound<T>::value) {
+    if (c != '{') return fail(ParseErrorCode::TypeMismatch);
+    return read_entries(
+        [&](std::string_view key) { return read_field(value, key); });
+  } else {
+    static_assert(json_unsupported<T>, "no JSON binding for this type");
+    return false;
+  }
+}
+
+template <typename Element>
+bool JSONReader::read_container(char close, Element element) {
+  if (depth >= options.max_depth) return fail(ParseErrorCode::TooDeep);
+  ++depth;
+  ++pos;
+  // [note]: a trailing comma is accepted like parse_sax does
+  for (;;) {
+    if (!skip()) return false;
+    if (json[pos] == close) break;
+    if (!element() || !skip()) return false;
+    if (json[pos] == ',') {
+      ++pos;
+      continue;
+    }
+    if (json[pos] != close) return fail(ParseErrorCode::ExpectedCommaOrClose);
+    break;
+  }
+  ++pos;
+  --depth;
+  return true;
+}
+
+template <typename Entry>
+bool JSONReader::read_entries(Entry entry) {
+  return read_container('}', [&] {
+    const char c = json[pos];
+    if (c != '"' && c != '\'') return fail(ParseErrorCode::ExpectedKey);
+    StringToken key =
+        scan_string(json.substr(pos), buffer, options.escape_extensions);
+    if (!key.eaten) return fail(ParseErrorCode::UnterminatedString);
+    pos += key.eaten;
+    if (!skip()) return false;
+    if (json[pos] != ':') return fail(ParseErrorCode::ExpectedColon);
+    ++pos;
+    return entry(key.value);
+  });
+}
+
+/*
+ * [note]: the key is compared with the constant hashes of the fields, one
+ * integer comparison per field, and the name only on a hash match, the first
+ * match reads its member and the rest of the fold is short-circuited
+ */
+template <typename T>
+bool JSONReader::read_field(T &value, std::string_view key) {
+  const uint64_t hash = json_key_hash(key);
+  int found = 0;  // 1 read, -1 failed
+  std::apply(
+      [&](const auto &...field) {
+        ((found == 0 && field.hash == hash && field.name == key
+              ? (found = read(value.*field.member) ? 1 : -1)
+              : 0),
+         ...);
+      },
+      JSONFields<T>::fields);
+  if (found) return found == 1;
+  if (!skip()) return false;
+  if (json[pos] == ',') return true;  // an empty value, see read()
+  size_t end = skip_value(json, pos);
+  if (end == std::string_view::npos) {
+    pos = json.size();
+    return fail(ParseErrorCode::UnexpectedEnd);
+  }
+  if (end == pos) return fail(ParseErrorCode::ExpectedValue);
+  pos = end;
+  return true;
+}
+
+// [note]: returns the characters eaten like parse_detail, 0 on failure, in
+// which case `value` may be partly read and ParseOptions::error tells why,
+// ParseOptions::stats only counts what JSONObject fields parse
+template <typename T>
+size_t from_json(std::string_view json, T &value,
+                 const ParseOptions &options = {}) {
+  if (options.error) *options.error = ParseError{};
+  JSONReader reader{json, options};
+  return reader.read(value) ? reader.position() : 0;
+}
+
+// [note]: the whole input must be the value, only spaces may follow it, as
+// with validate(), otherwise TrailingCharacters
+template <typename T>
+std::optional<T> from_json(std::string_view json,
+                           const ParseOptions &options = {}) {
+  T value{};
+  size_t eaten = from_json(json, value, options);
+  if (!eaten) return std::nullopt;
+  if (size_t end = skip_spaces(json, eaten); end != json.size()) {
+    if (options.error)
+      *options.error =
+          locate_error(json, ParseErrorCode::TrailingCharacters, end);
+    return std::nullopt;
+  }
+  return value;
+}
+
+// [note]: the events of value, so any handler (JSONWriter mostly) can take it
+template <typename T, typename Handler>
+void write_json(Handler &handler, const T &value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    handler.on_bool(value);
+  } else if constexpr (std::is_integral_v<T>) {
+    constexpr int low = std::numeric_limits<int>::min(),
+                  high = std::numeric_limits<int>::max();
+    bool fits;
+    if constexpr (std::is_signed_v<T>)
+      fits = low <= value && value <= high;
+    else
+      fits = value <= static_cast<unsigned>(high);
+    if (fits) {
+      handler.on_int(static_cast<int>(value));
+    } else {
+      char buf[24];
+      auto [end, ec] = std::to_chars(buf, buf + sizeof buf, value);
+      handler.on_number({buf, static_cast<size_t>(end - buf)});
+    }
+  } else if constexpr (std::is_floating_point_v<T>) {
+    handler.on_double(static_cast<double>(value));
+  } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+    handler.on_string(value);
+  } else if constexpr (std::is_same_v<T, JSONObject>) {
+    handler.on_value(value);
+  } else if constexpr (is_json_optional<T>::value) {
+    if (value)
+      write_json(handler, *value);
+    else
+      handler.on_null();
+  } else if constexpr (is_json_vector<T>::value) {
+    handler.start_array();
+    for (const auto &element : value) write_json(handler, element);
+    handler.end_array();
+  } else if constexpr (is_json_map<T>::value) {
+    handler.start_object();
+    for (const auto &[key, element] : value) {
+      handler.on_key(key);
+      write_json(handler, element);
+    }
+    handler.end_object();
+  } else if constexpr (is_json_bound<T>::value) {
+    handler.start_object();
+    std::apply(
+        [&](const auto &...field) {
+          ((handler.on_key(field.name),
+            write_json(handler, value.*field.member)),
+           ...);
+        },
+        JSONFields<T>::fields);
+    handler.end_object();
+  } else {
+    static_assert(json_unsupported<T>, "no JSON binding for this type");
+  }
+}
+
+template <typename T>
+void to_json(const T &value, std::string &out,
+             const SerializeOptions &options = {}) {
+  JSONWriter writer{out, options};
+  write_json(writer, value);
+}
+
+template <typename T>
+std::string to_json(const T &value, const SerializeOptions &options = {}) {
+  std::string out;
+  to_json(value, out, options);
+  return out;
+}
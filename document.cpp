@@ -0,0 +1,421 @@
+#include "document.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include "type.h"
+
+void *JSONArena::allocate(size_t bytes, size_t align) {
+  size_t pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+  if (pad + bytes > left) {
+    // [note]: blocks grow geometrically, a huge request gets a block of its own
+    size_t block = std::max(
+        first_block << std::min<size_t>(blocks.size(), max_shift),
+        bytes + align);
+    blocks.emplace_back(new char[block]);
+    sizes.push_back(block);
+    cur = blocks.back().get();
+    left = block;
+    total += block;
+    pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+  }
+  void *p = cur + pad;
+  cur += pad + bytes;
+  left -= pad + bytes;
+  return p;
+}
+
+void JSONArena::clear() {
+  if (blocks.empty()) return;
+  auto largest = std::max_element(sizes.begin(), sizes.end()) - sizes.begin();
+  std::unique_ptr<char[]> kept = std::move(blocks[largest]);
+  size_t kept_size = sizes[largest];
+  blocks.clear();
+  sizes.clear();
+  blocks.push_back(std::move(kept));
+  sizes.push_back(kept_size);
+  cur = blocks.back().get();
+  left = total = kept_size;
+}
+
+void JSONArena::reset() {
+  if (blocks.size() > 1) {
+    // [note]: the old blocks go first, so the memory is held only once
+    blocks.clear();
+    sizes.clear();
+    blocks.emplace_back(new char[total]);
+    sizes.push_back(total);
+  }
+  if (blocks.empty()) return;
+  cur = blocks.back().get();
+  left = total;
+}
+
+size_t JSONKeyTable::probe(std::string_view key, size_t hash) const {
+  size_t mask = slots.size() - 1;
+  for (size_t pos = hash & mask;; pos = (pos + 1) & mask)
+    if (!slots[pos] ||
+        (slots[pos]->hash == hash && slots[pos]->text() == key))
+      return pos;
+}
+
+void JSONKeyTable::grow() {
+  std::vector<const JSONKey *> old(std::max<size_t>(slots.size() * 2, 64));
+  old.swap(slots);
+  for (const JSONKey *key : old)
+    if (key) slots[probe(key->text(), key->hash)] = key;
+}
+
+const JSONKey *JSONKeyTable::intern(std::string_view key) {
+  size_t hash = hash_string(key);
+  if (!slots.empty())
+    if (const JSONKey *found = slots[probe(key, hash)]) return found;
+  if (count == max_keys || key.size() > UINT32_MAX) return nullptr;
+  // [note]: kept at most half full so probes stay short
+  if (2 * (count + 1) > slots.size()) grow();
+  char *data = memory.make_array<char>(key.size());
+  std::memcpy(data, key.data(), key.size());
+  JSONKey *interned = memory.make_array<JSONKey>(1);
+  *interned = {data, static_cast<uint32_t>(key.size()), hash};
+  slots[probe(key, hash)] = interned;
+  ++count;
+  return interned;
+}
+
+const JSONKey *JSONKeyTable::find(std::string_view key) const {
+  if (slots.empty()) return nullptr;
+  return slots[probe(key, hash_string(key))];
+}
+
+void JSONKeyTable::clear() {
+  memory.clear();
+  std::fill(slots.begin(), slots.end(), nullptr);
+  count = 0;
+}
+
+const JSONNode &JSONNodeList::at(size_t i) const {
+  if (i >= count) throw std::out_of_range{"JSONNodeList::at"};
+  return nodes[i];
+}
+
+const JSONNode *JSONNodeDict::find(std::string_view key) const {
+  for (const JSONNode *p = nodes; p != nodes + 2 * count; p += 2)
+    if (p->type == JSONNode::Type::String &&
+        std::string_view{p->str, p->size} == key)
+      return p + 1;
+  return nullptr;
+}
+
+const JSONNode *JSONNodeDict::find(const JSONKey &key) const {
+  // [note]: the size too, an empty key may share its address with the next
+  for (const JSONNode *p = nodes; p != nodes + 2 * count; p += 2)
+    if (p->str == key.data && p->size == key.size &&
+        p->type == JSONNode::Type::String)
+      return p + 1;
+  return nullptr;
+}
+
+const JSONNode &JSONNodeDict::at(std::string_view key) const {
+  if (const JSONNode *value = find(key)) return *value;
+  throw std::out_of_range{"JSONNodeDict::at"};
+}
+
+const JSONNode JSONDocument::null_node{};
+
+/*
+ * [note]: finished values wait on a scratch stack, when a container ends its
+ * children are the top of that stack, they are copied into the arena as one
+ * contiguous array and replaced by the container node itself
+ */
+class JSONDocumentBuilder {
+ public:
+  // [note]: strings found unescaped inside `source` are kept as views of it
+  // instead of being copied into the arena, keys go to `keys` if set, the
+  // stacks are those of `scratch` if set
+  explicit JSONDocumentBuilder(JSONArena &arena, std::string_view source = {},
+                               ParseStats *stats = nullptr,
+                               JSONKeyTable *keys = nullptr,
+                               JSONDocumentScratch *scratch = nullptr)
+      : arena{arena},
+        source{source},
+        stats{stats},
+        keys{keys},
+        values{scratch ? scratch->values : own.values},
+        frames{scratch ? scratch->frames : own.frames} {
+    values.clear();
+    frames.clear();
+  }
+
+  void on_null() { values.emplace_back(); }
+  void on_bool(bool b) {
+    values.emplace_back().type = JSONNode::Type::Bool;
+    values.back().b = b;
+  }
+  void on_int(int i) {
+    values.emplace_back().type = JSONNode::Type::Int;
+    values.back().i = i;
+  }
+  void on_double(double d) {
+    values.emplace_back().type = JSONNode::Type::Double;
+    values.back().d = d;
+  }
+  // [note]: false for a string too long for JSONNode::size, the parse stops
+  bool on_string(std::string_view s) {
+    if (s.size() > max_size) return oversize();
+    std::less_equal<const char *> before;
+    if (before(source.data(), s.data()) &&
+        before(s.data() + s.size(), source.data() + source.size())) {
+      ++views;
+      if (stats) stats->viewed_bytes += s.size();
+      push_string(s.data(), s.size());
+      return true;
+    }
+    if (stats) stats->copied_bytes += s.size();
+    char *str = arena.make_array<char>(s.size());
+    std::memcpy(str, s.data(), s.size());
+    push_string(str, s.size());
+    return true;
+  }
+  bool on_key(std::string_view s) {
+    const JSONKey *key = keys ? keys->intern(s) : nullptr;
+    if (!key) return on_string(s);
+    push_string(key->data, key->size);
+    return true;
+  }
+  void start_array() { frames.push_back({values.size(), false}); }
+  bool end_array() { return close(); }
+  void start_object() { frames.push_back({values.size(), true}); }
+  bool end_object() { return close(); }
+
+  // [note]: containers left open by a bad format are kept as they are, and a
+  // dict key waiting for its value is dropped, just like JSONObjectBuilder
+  const JSONNode *finish() {
+    while (!frames.empty()) close();
+    if (values.empty()) return &JSONDocument::null_node;
+    JSONNode *root = arena.make_array<JSONNode>(1);
+    *root = values.back();
+    return root;
+  }
+
+  size_t viewed() const { return views; }
+  // [note]: whether the parse stopped on something too large for a node
+  bool oversized() const { return too_large; }
+
+ private:
+  JSONArena &arena;
+  std::string_view source;
+  ParseStats *stats;
+  JSONKeyTable *keys;
+  size_t views = 0;
+  bool too_large = false;
+  static constexpr size_t max_size = UINT32_MAX;
+  using Frame = JSONDocumentScratch::Frame;
+  JSONDocumentScratch own;
+  std::vector<JSONNode> &values;
+  std::vector<Frame> &frames;
+
+  void push_string(const char *str, size_t size) {
+    JSONNode &node = values.emplace_back();
+    node.type = JSONNode::Type::String;
+    node.size = static_cast<uint32_t>(size);
+    node.str = str;
+  }
+
+  bool oversize() {
+    too_large = true;
+    return false;
+  }
+
+  // [note]: false for a container too large for JSONNode::size, its extra
+  // children are dropped in case finish() closes it after the failure
+  bool close() {
+    auto [start, is_dict] = frames.back();
+    frames.pop_back();
+    size_t n = values.size() - start;
+    if (is_dict && n % 2) --n;
+    const size_t limit = is_dict ? 2 * max_size : max_size;
+    const bool fits = n <= limit;
+    if (!fits) {
+      n = limit;
+      too_large = true;
+    }
+    JSONNode *children = arena.make_array<JSONNode>(n);
+    std::copy_n(values.begin() + start, n, children);
+    values.resize(start);
+    JSONNode &node = values.emplace_back();
+    node.type = is_dict ? JSONNode::Type::Dict : JSONNode::Type::List;
+    node.size = static_cast<uint32_t>(is_dict ? n / 2 : n);
+    node.children = children;
+    return fits;
+  }
+};
+
+// [note]: the arena blocks a parse added, a cleared arena reuses its largest
+static void count_blocks(const JSONArena &arena, size_t blocks,
+                         size_t capacity, ParseStats *stats) {
+  if (!stats) return;
+  stats->allocations += arena.block_count() - blocks;
+  stats->allocated_bytes += arena.capacity() - capacity;
+}
+
+size_t JSONDocument::build(std::string_view json, bool view,
+                           const ParseOptions &options,
+                           JSONDocumentScratch &scratch) {
+  const size_t blocks = memory.block_count(), capacity = memory.capacity();
+  JSONDocumentBuilder builder{memory, view ? json : std::string_view{},
+                              options.stats, options.keys, &scratch};
+  size_t eaten = parse_sax(json, builder, options, scratch.sax);
+  // [note]: the builder stopped the parse, not a handler of the caller's
+  if (builder.oversized() && options.error &&
+      options.error->code == ParseErrorCode::Stopped)
+    options.error->code = ParseErrorCode::TooLarge;
+  root_node = builder.finish();
+  count_blocks(memory, blocks, capacity, options.stats);
+  source_view = builder.viewed() ? json : std::string_view{};
+  return eaten;
+}
+
+size_t JSONDocument::parse(std::string_view json,
+                           const ParseOptions &options) {
+  // [note]: json may view the current mapping, unmapped once parsed
+  MappedFile old = std::move(mapping);
+  memory.clear();
+  JSONDocumentScratch scratch;
+  return build(json, false, options, scratch);
+}
+
+size_t JSONDocument::parse_view(std::string_view json,
+                                const ParseOptions &options) {
+  // [note]: json may view the current mapping, e.g. a slice of source(), the
+  // mapping is then kept as long as the new document views it too
+  MappedFile old = std::move(mapping);
+  memory.clear();
+  JSONDocumentScratch scratch;
+  size_t eaten = build(json, true, options, scratch);
+  std::string_view mapped = old.view();
+  std::less_equal<const char *> before;
+  if (!source_view.empty() && before(mapped.data(), json.data()) &&
+      before(json.data() + json.size(), mapped.data() + mapped.size()))
+    mapping = std::move(old);
+  return eaten;
+}
+
+size_t JSONDocument::parse_file(const std::string &path,
+                                const ParseOptions &options) {
+  MappedFile file;
+  if (!file.open(path)) {
+    parse({}, options);
+    return 0;
+  }
+  return parse(file.view(), options);
+}
+
+size_t JSONDocument::parse_file_view(const std::string &path,
+                                     const ParseOptions &options) {
+  MappedFile file;
+  if (!file.open(path)) {
+    parse({}, options);
+    return 0;
+  }
+  size_t eaten = parse_view(file.view(), options);
+  if (!source_view.empty()) mapping = std::move(file);
+  return eaten;
+}
+
+JSONObject to_object(const JSONNode &node) {
+  switch (node.type) {
+    case JSONNode::Type::Null:
+      return JSONObject{std::monostate{}};
+    case JSONNode::Type::Bool:
+      return JSONObject{node.b};
+    case JSONNode::Type::Int:
+      return JSONObject{node.i};
+    case JSONNode::Type::Double:
+      return JSONObject{node.d};
+    case JSONNode::Type::String:
+      return JSONObject{std::string{node.str, node.size}};
+    case JSONNode::Type::List: {
+      JSONList list;
+      list.reserve(node.size);
+      for (const JSONNode &element : get<JSONNodeList>(node))
+        list.push_back(to_object(element));
+      return JSONObject{std::move(list)};
+    }
+    case JSONNode::Type::Dict: {
+      JSONDict dict;
+      for (const auto &[key, value] : get<JSONNodeDict>(node))
+        dict.insert_or_assign(to_object(key), to_object(value));
+      return JSONObject{std::move(dict)};
+    }
+  }
+  return JSONObject{std::monostate{}};
+}
+
+JSONDocument::JSONDocument(const JSONObject &obj) {
+  // [note]: replay the tree as builder events so both ways share one layout
+  JSONDocumentBuilder builder{memory};
+  auto replay = [&](auto &self, const JSONObject &obj) -> void {
+    std::visit(overloaded{[&](std::monostate) { builder.on_null(); },
+                          [&](bool b) { builder.on_bool(b); },
+                          [&](int i) { builder.on_int(i); },
+                          [&](double d) { builder.on_double(d); },
+                          [&](const std::string &s) { builder.on_string(s); },
+                          [&](const JSONList &list) {
+                            builder.start_array();
+                            for (const auto &element : list)
+                              self(self, element);
+                            builder.end_array();
+                          },
+                          [&](const JSONDict &dict) {
+                            builder.start_object();
+                            for (const auto &[key, value] : dict) {
+                              self(self, key);
+                              self(self, value);
+                            }
+                            builder.end_object();
+                          },
+                          [&](const JSONShared &shared) {
+                            self(self, shared->value);
+                          }},
+               obj.inner);
+  };
+  replay(replay, obj);
+  root_node = builder.finish();
+}
+
+size_t JSONParser::run(std::string_view json, bool view,
+                       const ParseOptions &options) {
+  if (usage().total() > memory_limit) {
+    release();
+    ++released;
+  } else {
+    reset();
+  }
+  ParseOptions local = options;
+  if (!local.keys) local.keys = &keys;
+  return doc.build(json, view, local, scratch);
+}
+
+size_t JSONParser::parse(std::string_view json, const ParseOptions &options) {
+  return run(json, false, options);
+}
+
+size_t JSONParser::parse_view(std::string_view json,
+                              const ParseOptions &options) {
+  return run(json, true, options);
+}
+
+void JSONParser::reset() {
+  doc.memory.reset();
+  doc.root_node = &JSONDocument::null_node;
+  doc.source_view = {};
+}
+
+void JSONParser::release() {
+  doc = JSONDocument{};
+  // [note]: not clear(), which would keep the largest block of keys
+  keys = JSONKeyTable{keys.max_size()};
+  scratch = JSONDocumentScratch{};
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "mapped_file.h"
+#include "parser.h"
+#include "simpleJSON.h"
+
+/*
+ * [note]: a bump allocator, memory is handed out from big blocks and only
+ * released all at once when the arena dies, so there is neither a per-node
+ * free nor a destructor call for anything living inside it
+ */
+class JSONArena {
+ public:
+  JSONArena() = default;
+  JSONArena(JSONArena &&other) noexcept { *this = std::move(other); }
+  JSONArena &operator=(JSONArena &&other) noexcept {
+    blocks = std::move(other.blocks);
+    sizes = std::move(other.sizes);
+    cur = std::exchange(other.cur, nullptr);
+    left = std::exchange(other.left, 0);
+    total = std::exchange(other.total, 0);
+    return *this;
+  }
+
+  void *allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+  template <typename T>
+  T *make_array(size_t n) {
+    static_assert(std::is_trivially_destructible_v<T>);
+    return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+  }
+  // [note]: drops every block but the largest one, which is kept for reuse
+  void clear();
+  // [note]: keeps the whole capacity instead, several blocks are merged into
+  // one as large as all of them, so what fitted before fits without a block
+  void reset();
+  size_t capacity() const { return total; }
+  size_t block_count() const { return blocks.size(); }
+
+ private:
+  // [note]: blocks grow from 4KB to 1MB
+  static constexpr size_t first_block = 4096, max_shift = 8;
+  std::vector<std::unique_ptr<char[]>> blocks;
+  std::vector<size_t> sizes;
+  char *cur = nullptr;
+  size_t left = 0, total = 0;
+};
+
+// [note]: an interned key, its bytes and itself live in the JSONKeyTable
+struct JSONKey {
+  const char *data;
+  uint32_t size;
+  size_t hash;  // hash_string(), what JSONDict::find expects
+
+  std::string_view text() const { return {data, size}; }
+};
+
+/*
+ * [note]: one immutable copy of each distinct dict key with its hash computed
+ * once, documents parsed with ParseOptions::keys pointing to a table make
+ * their key nodes point to it, so identical keys share storage and
+ * JSONNodeDict::find(const JSONKey &) compares addresses only
+ * meant to outlive many parses, e.g. one per worker for record-style input,
+ * the table must outlive the documents using it and is not thread safe
+ * new keys are no longer interned once max_keys are held, so data used as
+ * keys (ids, timestamps) cannot grow it forever, those are copied as usual
+ */
+class JSONKeyTable {
+ public:
+  explicit JSONKeyTable(size_t max_keys = 1 << 16) : max_keys{max_keys} {}
+
+  // [note]: nullptr when the key is new and the table is full
+  const JSONKey *intern(std::string_view key);
+  // [note]: never adds, nullptr if absent
+  const JSONKey *find(std::string_view key) const;
+  size_t size() const { return count; }
+  size_t max_size() const { return max_keys; }
+  // [note]: bytes held by the keys and the index
+  size_t capacity() const {
+    return memory.capacity() + slots.capacity() * sizeof(const JSONKey *);
+  }
+  // [note]: every key handed out before, and the documents using them, dangle
+  void clear();
+
+ private:
+  JSONArena memory;
+  std::vector<const JSONKey *> slots;  // open addressing, power of two
+  size_t count = 0, max_keys;
+
+  size_t probe(std::string_view key, size_t hash) const;
+  void grow();
+};
+
+/*
+ * [note]: a 16 bytes tagged node, the alternatives follow the order of
+ * JSONObject::inner so index() means the same thing, a JSONShared becomes
+ * the node of what it shares
+ */
+struct JSONNode {
+  enum class Type : uint8_t { Null, Bool, Int, Double, String, List, Dict };
+  Type type = Type::Null;
+  uint32_t size = 0;  // string length, list elements or dict entries
+  union {
+    bool b;
+    int i;
+    double d;
+    const char *str;
+    const JSONNode *children;
+  };
+
+  JSONNode() : children{nullptr} {}
+  size_t index() const { return static_cast<size_t>(type); }
+};
+static_assert(sizeof(JSONNode) == 16 || sizeof(void *) != 8);
+
+// [note]: read-only views of a node's children, both point into the arena
+struct JSONNodeList {
+  const JSONNode *nodes = nullptr;
+  size_t count = 0;
+
+  const JSONNode *begin() const { return nodes; }
+  const JSONNode *end() const { return nodes + count; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const JSONNode &operator[](size_t i) const { return nodes[i]; }
+  const JSONNode &at(size_t i) const;
+};
+
+struct JSONNodeDict {
+  const JSONNode *nodes = nullptr;  // key value key value ...
+  size_t count = 0;                 // number of entries
+
+  struct iterator {
+    const JSONNode *p;
+    std::pair<const JSONNode &, const JSONNode &> operator*() const {
+      return {p[0], p[1]};
+    }
+    iterator &operator++() {
+      p += 2;
+      return *this;
+    }
+    bool operator!=(const iterator &other) const { return p != other.p; }
+  };
+  iterator begin() const { return {nodes}; }
+  iterator end() const { return {nodes + 2 * count}; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  // [note]: linear lookup of a string key, nullptr if absent
+  const JSONNode *find(std::string_view key) const;
+  // [note]: by address, only finds keys of documents parsed with key's table
+  const JSONNode *find(const JSONKey &key) const;
+  const JSONNode &at(std::string_view key) const;
+};
+
+/*
+ * [note]: get/get_if/holds_alternative mirror their std:: counterparts on
+ * JSONObject::inner, the alternatives are
+ *   std::monostate bool int double std::string_view JSONNodeList JSONNodeDict
+ */
+template <typename T>
+constexpr JSONNode::Type node_type() {
+  if constexpr (std::is_same_v<T, std::monostate>)
+    return JSONNode::Type::Null;
+  else if constexpr (std::is_same_v<T, bool>)
+    return JSONNode::Type::Bool;
+  else if constexpr (std::is_same_v<T, int>)
+    return JSONNode::Type::Int;
+  else if constexpr (std::is_same_v<T, double>)
+    return JSONNode::Type::Double;
+  else if constexpr (std::is_same_v<T, std::string_view>)
+    return JSONNode::Type::String;
+  else if constexpr (std::is_same_v<T, JSONNodeList>)
+    return JSONNode::Type::List;
+  else {
+    static_assert(std::is_same_v<T, JSONNodeDict>, "not a JSONNode type");
+    return JSONNode::Type::Dict;
+  }
+}
+
+template <typename T>
+bool holds_alternative(const JSONNode &node) {
+  return node.type == node_type<T>();
+}
+
+template <typename T>
+T get(const JSONNode &node) {
+  if (!holds_alternative<T>(node)) throw std::bad_variant_access{};
+  if constexpr (std::is_same_v<T, std::monostate>)
+    return {};
+  else if constexpr (std::is_same_v<T, bool>)
+    return node.b;
+  else if constexpr (std::is_same_v<T, int>)
+    return node.i;
+  else if constexpr (std::is_same_v<T, double>)
+    return node.d;
+  else if constexpr (std::is_same_v<T, std::string_view>)
+    return {node.str, node.size};
+  else
+    return {node.children, node.size};
+}
+
+// [note]: unlike std::get_if, returns by value since the views are cheap
+template <typename T>
+std::optional<T> get_if(const JSONNode *node) {
+  if (!node || !holds_alternative<T>(*node)) return std::nullopt;
+  return get<T>(*node);
+}
+
+JSONObject to_object(const JSONNode &node);
+
+// [note]: the scratch stacks of a parse into a JSONDocument, see JSONParser
+struct JSONDocumentScratch {
+  struct Frame {
+    size_t start;  // where the container's children begin in values
+    bool is_dict;
+  };
+  ParseScratch sax;
+  std::vector<JSONNode> values;  // finished values waiting for their container
+  std::vector<Frame> frames;
+
+  size_t capacity() const {
+    return sax.capacity() + values.capacity() * sizeof(JSONNode) +
+           frames.capacity() * sizeof(Frame);
+  }
+};
+
+/*
+ * [note]: a whole parsed document, nodes, strings and child arrays all live in
+ * the document's arena, so a document costs a handful of block allocations
+ * and is destroyed at once, convert with to_object/JSONDocument(JSONObject)
+ * where a JSONObject is expected
+ */
+class JSONDocument {
+ public:
+  JSONDocument() = default;
+  explicit JSONDocument(const JSONObject &obj);
+  JSONDocument(JSONDocument &&other) noexcept { *this = std::move(other); }
+  JSONDocument &operator=(JSONDocument &&other) noexcept {
+    memory = std::move(other.memory);
+    root_node = std::exchange(other.root_node, &null_node);
+    source_view = std::exchange(other.source_view, {});
+    mapping = std::move(other.mapping);
+    return *this;
+  }
+
+  // [note]: replaces the content, same return value as parse_detail
+  size_t parse(std::string_view json, const ParseOptions &options = {});
+  /*
+   * [note]: zero-copy parse, strings without escapes are kept as views of
+   * `json` and only escaped ones are decoded into the arena
+   * lifetime contract: the buffer viewed by `json` must stay alive and
+   * unchanged as long as the document (or any string_view read from it) is
+   * used, source() tells whether the document views anything at all
+   */
+  size_t parse_view(std::string_view json, const ParseOptions &options = {});
+  /*
+   * [note]: parse straight from a memory mapping of the file, parse_file
+   * copies every string into the arena and unmaps the file before returning,
+   * parse_file_view keeps the mapping as the document's source as long as
+   * some string views it, an unreadable file gives null with 0 eaten
+   */
+  size_t parse_file(const std::string &path, const ParseOptions &options = {});
+  size_t parse_file_view(const std::string &path,
+                         const ParseOptions &options = {});
+  std::string_view source() const { return source_view; }
+  const JSONNode &root() const { return *root_node; }
+  JSONObject to_object() const { return ::to_object(root()); }
+  const JSONArena &arena() const { return memory; }
+
+ private:
+  friend class JSONDocumentBuilder;
+  friend class JSONParser;
+  JSONArena memory;
+  const JSONNode *root_node = &null_node;
+  std::string_view source_view;
+  MappedFile mapping;  // owns source_view after parse_file_view
+  static const JSONNode null_node;
+
+  // [note]: parses into the arena as it is, strings are views of json if
+  // `view` is set
+  size_t build(std::string_view json, bool view, const ParseOptions &options,
+               JSONDocumentScratch &scratch);
+};
+
+/*
+ * [note]: a parse context for workers parsing many documents one after the
+ * other, everything a document parse allocates is kept for the next one: the
+ * arena, the dict keys (interned in the parser's own JSONKeyTable unless
+ * ParseOptions::keys says otherwise), the scratch stacks of parse_sax and of
+ * the builder, so once the largest document has been seen, parsing documents
+ * of the same shape makes no allocation at all
+ * the document is valid until the next parse, reset or release, a parser is
+ * not thread safe, use one per worker
+ */
+class JSONParser {
+ public:
+  // [note]: what a parser holds between parses, in bytes
+  struct Usage {
+    size_t arena = 0, keys = 0, scratch = 0;
+
+    size_t total() const { return arena + keys + scratch; }
+  };
+
+  // [note]: a parse starting with more than memory_limit bytes held releases
+  // them first, so one huge document doesn't pin its memory forever
+  explicit JSONParser(size_t memory_limit = 64 << 20,
+                      size_t max_keys = 1 << 16)
+      : keys{max_keys}, memory_limit{memory_limit} {}
+
+  // [note]: like JSONDocument::parse/parse_view, replacing the document
+  size_t parse(std::string_view json, const ParseOptions &options = {});
+  size_t parse_view(std::string_view json, const ParseOptions &options = {});
+  const JSONDocument &document() const { return doc; }
+  const JSONNode &root() const { return doc.root(); }
+
+  // [note]: drops the document but keeps the capacity
+  void reset();
+  // [note]: drops the document, the keys and the capacity
+  void release();
+  Usage usage() const {
+    return {doc.memory.capacity(), keys.capacity(), scratch.capacity()};
+  }
+  // [note]: how many times the memory limit was hit
+  size_t releases() const { return released; }
+
+ private:
+  JSONDocument doc;
+  JSONKeyTable keys;
+  JSONDocumentScratch scratch;
+  size_t memory_limit, released = 0;
+
+  size_t run(std::string_view json, bool view, const ParseOptions &options);
+};
@@ -0,0 +1,112 @@
+#include "lazy.h"
+
+#include "scanner.h"
+
+static constexpr size_t npos = std::string_view::npos;
+
+static size_t skip_string(std::string_view json, size_t pos) {
+  const char quote = json[pos];
+  for (++pos;;) {
+    pos = find_quote_or_escape(json, pos, quote);
+    if (pos >= json.size()) return npos;
+    if (json[pos] != '\\') return pos + 1;
+    pos += 2;
+  }
+}
+
+size_t skip_value(std::string_view json, size_t pos) {
+  const size_t size = json.size();
+  if (pos >= size) return npos;
+  const char c = json[pos];
+  if (c == '"' || c == '\'') return skip_string(json, pos);
+  if (c != '[' && c != '{') {
+    while (pos < size && is_word(json[pos])) ++pos;
+    return pos;
+  }
+  size_t depth = 0;
+  for (pos = find_structural(json, pos); pos < size;
+       pos = find_structural(json, pos)) {
+    const char c = json[pos];
+    if (c == '"' || c == '\'') {
+      pos = skip_string(json, pos);
+      if (pos == npos) return npos;
+    } else if (c == '[' || c == '{') {
+      ++depth;
+      ++pos;
+    } else {
+      ++pos;
+      if (--depth == 0) return pos;
+    }
+  }
+  return npos;
+}
+
+JSONCursor::JSONCursor(std::string_view json) : json{json} {
+  if (size_t start = skip_spaces(json, 0); start < json.size()) pos = start;
+}
+
+size_t JSONCursor::index() const {
+  if (!valid()) return std::variant_npos;
+  std::string_view rest = json.substr(pos);
+  switch (rest[0]) {
+    case ',':
+      return 0;  // [note]: an empty slot read as null
+    case '"':
+    case '\'':
+      return 4;
+    case '[':
+      return 5;
+    case '{':
+      return 6;
+  }
+  if (rest.compare(0, 4, "null") == 0) return 0;
+  if (rest.compare(0, 4, "true") == 0 || rest.compare(0, 5, "false") == 0)
+    return 1;
+  if (NumberToken num = scan_number(rest); num.eaten) return num.is_int ? 2 : 3;
+  return std::variant_npos;
+}
+
+std::string_view JSONCursor::raw() const {
+  if (!valid()) return {};
+  size_t end = skip_value(json, pos);
+  return json.substr(pos, end == npos ? npos : end - pos);
+}
+
+JSONObject JSONCursor::decode() const {
+  if (!valid() || json[pos] == ',') return JSONObject{std::monostate{}};
+  return parse_detail(raw()).first;
+}
+
+JSONCursor JSONCursor::find(std::string_view key) const {
+  if (!valid() || json[pos] != '{') return {};
+  JSONCursor found;
+  std::string buffer;
+  // [note]: parse keeps the last of duplicate keys, so the whole dict is seen
+  each([&](const JSONCursor &k, const JSONCursor &value) {
+    if (json[k.pos] == '"' || json[k.pos] == '\'') {
+      StringToken str = scan_string(json.substr(k.pos), buffer);
+      if (str.eaten && str.value == key) found = value;
+    }
+    return true;
+  });
+  return found;
+}
+
+JSONCursor JSONCursor::at(size_t i) const {
+  if (!valid() || json[pos] != '[') return {};
+  JSONCursor found;
+  each([&](const JSONCursor &, const JSONCursor &element) {
+    if (i-- == 0) found = element;
+    return !found.valid();
+  });
+  return found;
+}
+
+size_t JSONCursor::size() const {
+  size_t count = 0;
+  each([&](const JSONCursor &, const JSONCursor &) {
+    ++count;
+    return true;
+  });
+  return count;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include "parser.h"
+#include "scanner.h"
+#include "simpleJSON.h"
+
+// [note]: the position right after the value starting at pos, npos if it is
+// not terminated, containers are matched by brackets only
+size_t skip_value(std::string_view json, size_t pos);
+
+/*
+ * [note]: on-demand access, a cursor is a position in the source text and
+ * nothing is decoded until it is asked for, finding a child passes over the
+ * siblings before it with a bracket and quote aware skip (strings are jumped
+ * through with the vectorized quote scan) instead of parsing them
+ * decode() runs parse_detail on the value's own text, so whatever is read
+ * equals the same part of parse(json), the lenient compatibilities included
+ * (an empty slot before ',' is null, a trailing comma is ignored, the last of
+ * duplicate keys wins), but the parts that are skipped are not validated
+ *
+ * the text must outlive the cursors, a missing child gives an invalid cursor
+ * on which every further lookup is invalid too, e.g.
+ *   JSONCursor{json}["user"]["roles"][1].decode()
+ */
+class JSONCursor {
+ public:
+  JSONCursor() = default;
+  // [note]: the top-level value of json
+  explicit JSONCursor(std::string_view json);
+
+  bool valid() const { return pos != std::string_view::npos; }
+  explicit operator bool() const { return valid(); }
+  // [note]: same as JSONObject::inner.index(), std::variant_npos if invalid
+  // or not a value, only numbers are scanned to tell int from double
+  size_t index() const;
+  // [note]: the value's text, found by skipping it
+  std::string_view raw() const;
+  JSONObject decode() const;
+
+  JSONCursor find(std::string_view key) const;
+  JSONCursor at(size_t i) const;
+  JSONCursor operator[](std::string_view key) const { return find(key); }
+  JSONCursor operator[](size_t i) const { return at(i); }
+  // [note]: list elements or dict entries, counted by skipping them
+  size_t size() const;
+
+  /*
+   * [note]: fn(JSONCursor element) for a list, fn(JSONCursor key, JSONCursor
+   * value) for a dict, like a SAX handler fn may return false to stop
+   */
+  template <typename Fn>
+  void for_each(Fn fn) const {
+    each([&](const JSONCursor &key, const JSONCursor &value) {
+      if constexpr (std::is_invocable_v<Fn, JSONCursor, JSONCursor>)
+        return sax_emit([&] { return fn(key, value); });
+      else
+        return sax_emit([&] { return fn(value); });
+    });
+  }
+
+ private:
+  std::string_view json;
+  size_t pos = std::string_view::npos;
+
+  JSONCursor(std::string_view json, size_t pos) : json{json}, pos{pos} {}
+  // [note]: calls fn(key, value) per child, key is invalid in a list, stops
+  // when fn returns false
+  template <typename Fn>
+  void each(Fn fn) const;
+};
+
+/*
+ * [note]: follows the loop of parse_sax, a ',' where a value is expected is
+ * null and a closing bracket where one is expected ends the container, any
+ * other surprise ends the walk as the parse would fail there
+ */
+template <typename Fn>
+void JSONCursor::each(Fn fn) const {
+  if (!valid() || (json[pos] != '[' && json[pos] != '{')) return;
+  const bool is_dict = json[pos] == '{';
+  const char close = is_dict ? '}' : ']';
+  size_t p = skip_spaces(json, pos + 1);
+  while (p < json.size() && json[p] != close) {
+    JSONCursor key;
+    if (is_dict) {
+      size_t end = skip_value(json, p);
+      if (json[p] == ',' || end == std::string_view::npos || end == p) return;
+      key = JSONCursor{json, p};
+      p = skip_spaces(json, end);
+      if (p >= json.size() || json[p] != ':') return;
+      p = skip_spaces(json, p + 1);
+      if (p >= json.size() || json[p] == close) return;
+    }
+    size_t end = json[p] == ',' ? p : skip_value(json, p);
+    if (end == std::string_view::npos || (end == p && json[p] != ',')) return;
+    if (!fn(key, JSONCursor{json, p})) return;
+    p = skip_spaces(json, end);
+    if (p >= json.size()) return;
+    if (json[p] == ',')
+      p = skip_spaces(json, p + 1);
+    else if (json[p] != close)
+      return;
+  }
+}
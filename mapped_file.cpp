@@ -0,0 +1,82 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string &path) {
+  close();
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER file_size;
+  bool ok = GetFileSizeEx(file, &file_size);
+  if (ok && file_size.QuadPart > 0) {
+    // [note]: the view keeps the file mapped after both handles are closed
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void *p =
+        mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) CloseHandle(mapping);
+    ok = p != nullptr;
+    if (ok) {
+      data = static_cast<const char *>(p);
+      size = static_cast<size_t>(file_size.QuadPart);
+    }
+  }
+  CloseHandle(file);
+  return ok;
+}
+
+void MappedFile::close() {
+  if (data) UnmapViewOfFile(data);
+  data = nullptr;
+  size = 0;
+}
+#else
+bool MappedFile::open(const std::string &path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  if (ok && st.st_size > 0) {
+    // [note]: the mapping keeps the file referenced after fd is closed
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = p != MAP_FAILED;
+    if (ok) {
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+      data = static_cast<const char *>(p);
+      size = static_cast<size_t>(st.st_size);
+    }
+  }
+  ::close(fd);
+  return ok;
+}
+
+void MappedFile::close() {
+  if (data) munmap(const_cast<char *>(data), size);
+  data = nullptr;
+  size = 0;
+}
+#endif
+
+std::pair<JSONObject, size_t> parse_file_detail(const std::string &path,
+                                                const ParseOptions &options) {
+  MappedFile file;
+  if (!file.open(path)) return {JSONObject{std::monostate{}}, 0};
+  return parse_detail(file.view(), options);
+}
+
+JSONObject parse_file(const std::string &path, const ParseOptions &options) {
+  return parse_file_detail(path, options).first;
+}
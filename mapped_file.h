@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "parser.h"
+#include "simpleJSON.h"
+
+/*
+ * [note]: a read-only memory mapping of a whole file, pages are read in by
+ * the kernel as the parser touches them, so there is neither a copy into a
+ * std::string nor a second buffer of the file size, the kernel is told the
+ * access is sequential (madvise/FILE_FLAG_SEQUENTIAL_SCAN) to read ahead
+ * the mapping lives until close() or the destructor, views into it dangle
+ * afterwards
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &path) { open(path); }
+  MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      close();
+      data = std::exchange(other.data, nullptr);
+      size = std::exchange(other.size, 0);
+    }
+    return *this;
+  }
+  ~MappedFile() { close(); }
+
+  // [note]: false if the file cannot be opened or mapped, an empty file is
+  // opened fine and gives an empty view
+  bool open(const std::string &path);
+  void close();
+  std::string_view view() const { return {data, size}; }
+
+ private:
+  const char *data = nullptr;
+  size_t size = 0;
+};
+
+// [note]: like parse_detail, an unreadable file gives null with 0 eaten
+std::pair<JSONObject, size_t> parse_file_detail(
+    const std::string &path, const ParseOptions &options = {});
+
+JSONObject parse_file(const std::string &path,
+                      const ParseOptions &options = {});
@@ -0,0 +1,71 @@
+#include "ndjson.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "scanner.h"
+
+std::vector<NDJSONRecord> parse_ndjson(std::string_view buffer,
+                                       const NDJSONOptions &options) {
+  /*** cut lines ***/
+  std::vector<NDJSONRecord> records;
+  std::vector<std::string_view> lines;
+  const char *data = buffer.data();
+  const size_t size = buffer.size();
+  for (size_t pos = 0, line = 1; pos < size; ++line) {
+    auto *newline =
+        static_cast<const char *>(std::memchr(data + pos, '\n', size - pos));
+    size_t end = newline ? newline - data : size;
+    std::string_view text = buffer.substr(pos, end - pos);
+    if (skip_spaces(text, 0) != text.size()) {
+      NDJSONRecord &record = records.emplace_back();
+      record.offset = pos;
+      record.line = line;
+      lines.push_back(text);
+    }
+    pos = end + 1;
+  }
+
+  /*** parse records in batches ***/
+  // [note]: large enough to make the shared counter cheap, small enough to
+  // balance records of uneven sizes
+  constexpr size_t batch = 64;
+  const size_t count = records.size();
+  std::atomic<size_t> next{0};
+  std::mutex stats_mutex;
+  auto work = [&] {
+    // [note]: each worker fills its own stats, merged once it is done, the
+    // error isn't shared at all, every record has its own `ok`
+    ParseStats stats;
+    ParseOptions parse_options = options.parse;
+    if (parse_options.stats) parse_options.stats = &stats;
+    parse_options.error = nullptr;
+    for (;;) {
+      size_t begin = next.fetch_add(batch, std::memory_order_relaxed);
+      if (begin >= count) break;
+      for (size_t i = begin; i < std::min(begin + batch, count); ++i) {
+        auto [value, eaten] = parse_detail(lines[i], parse_options);
+        records[i].value = std::move(value);
+        // [note]: parse_detail leaves trailing characters uneaten
+        records[i].ok =
+            eaten && skip_spaces(lines[i], eaten) == lines[i].size();
+      }
+    }
+    if (options.parse.stats) {
+      std::lock_guard<std::mutex> lock{stats_mutex};
+      *options.parse.stats += stats;
+    }
+  };
+  size_t threads = options.threads
+                       ? options.threads
+                       : std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, (count + batch - 1) / batch);
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; ++t) workers.emplace_back(work);
+  work();
+  for (auto &worker : workers) worker.join();
+  return records;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "parser.h"
+#include "simpleJSON.h"
+
+struct NDJSONOptions {
+  // [note]: worker threads including the calling one, 0 means
+  // std::thread::hardware_concurrency()
+  unsigned threads = 0;
+  ParseOptions parse;
+};
+
+struct NDJSONRecord {
+  JSONObject value;  // what was parsed before the error for a bad record
+  size_t offset = 0;  // where the record's line starts in the buffer
+  size_t line = 0;    // 1-based line number
+  bool ok = false;    // the whole line is exactly one valid value
+};
+
+/*
+ * [note]: newline-delimited JSON, one value per line, blank lines are skipped
+ * lines are cut first, then parsed by a pool of workers which take batches of
+ * consecutive records from a shared counter, so long and short records even
+ * out across cores, each worker writes its records in place and the result
+ * follows the input order whatever the thread count
+ */
+std::vector<NDJSONRecord> parse_ndjson(std::string_view buffer,
+                                       const NDJSONOptions &options = {});
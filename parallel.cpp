@@ -0,0 +1,404 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "scanner.h"
+
+// [note]: where a chunk boundary may fall, relative to strings
+enum class ScanState : uint8_t {
+  Out,
+  Double,        // inside "..."
+  Single,        // inside '...'
+  DoubleEscape,  // right after a '\\' inside "..."
+  SingleEscape,  // right after a '\\' inside '...'
+};
+constexpr size_t scan_state_count = 5;
+
+// [note]: what a container being split needs to be cut, besides brackets and
+// quotes
+static bool is_split_char(char c) {
+  switch (c) {
+    case ',':
+    case ':':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '"':
+    case '\'':
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*
+ * [note]: scans data[pos, end) from `state` with `depth` containers open,
+ * returns the state at `end` and leaves the depth there in `depth`
+ * with Collect, found(pos) receives each ',' and ':' outside strings at depth
+ * 1 and each bracket closing depth 1, those are looked for byte by byte while
+ * at depth 1, elsewhere the kernels jump from bracket/quote to bracket/quote
+ */
+template <bool Collect, typename Found>
+static ScanState scan_chunk(const char *data, size_t pos, size_t end,
+                            ScanState state, long &depth, Found found) {
+  while (pos < end) {
+    switch (state) {
+      case ScanState::DoubleEscape:
+      case ScanState::SingleEscape:
+        ++pos;
+        state = state == ScanState::DoubleEscape ? ScanState::Double
+                                                 : ScanState::Single;
+        break;
+      case ScanState::Double:
+      case ScanState::Single: {
+        const bool is_double = state == ScanState::Double;
+        pos = scan_kernels.find_quote_or_escape(data, pos, end,
+                                                is_double ? '"' : '\'');
+        if (pos == end) break;
+        if (data[pos++] != '\\')
+          state = ScanState::Out;
+        else
+          state = is_double ? ScanState::DoubleEscape : ScanState::SingleEscape;
+        break;
+      }
+      case ScanState::Out: {
+        if (Collect && depth == 1) {
+          while (pos < end && !is_split_char(data[pos])) ++pos;
+        } else {
+          pos = scan_kernels.find_structural(data, pos, end);
+        }
+        if (pos == end) break;
+        switch (data[pos]) {
+          case '"':
+            state = ScanState::Double;
+            break;
+          case '\'':
+            state = ScanState::Single;
+            break;
+          case '[':
+          case '{':
+            ++depth;
+            break;
+          case ']':
+          case '}':
+            if (Collect && depth == 1) found(pos);
+            --depth;
+            break;
+          default:  // [note]: ',' or ':', only looked for at depth 1
+            found(pos);
+            break;
+        }
+        ++pos;
+        break;
+      }
+    }
+  }
+  return state;
+}
+
+template <typename Policy>
+static bool spaces_only(std::string_view s) {
+  if (skip_spaces(s, 0) != s.size()) return false;
+  if constexpr (!Policy::extra_spaces)
+    return s.find_first_of("\f\v") == std::string_view::npos;
+  return true;
+}
+
+// [note]: runs work(i) for i in [0, threads), the calling thread included
+template <typename Work>
+static void run_workers(size_t threads, Work work) {
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; ++i) workers.emplace_back(work, i);
+  work(0);
+  for (auto &worker : workers) worker.join();
+}
+
+template <typename Policy>
+class ParallelParser {
+ public:
+  ParallelParser(std::string_view json, const ParallelOptions &options,
+                 size_t threads)
+      : json{json}, options{options}, threads{threads} {}
+
+  /*
+   * [note]: the list/dict opening at json[open] at nesting level `depth`,
+   * parsed with its elements spread over the workers, along with the
+   * position after its closing bracket, nullopt if a sequential parse has to
+   * decide
+   */
+  std::optional<std::pair<JSONObject, size_t>> split(size_t open,
+                                                     size_t limit,
+                                                     size_t depth);
+
+  ParseStats stats;  // [note]: only filled if ParseOptions::stats is set
+
+ private:
+  // [note]: a list element is [begin, end), a dict entry has its key in
+  // [begin, colon) and its value in (colon, end)
+  struct Element {
+    size_t begin, colon, end;
+  };
+  std::string_view json;
+  const ParallelOptions &options;
+  size_t threads;
+  std::mutex stats_mutex;
+
+  std::vector<size_t> index(size_t open, size_t limit);
+  bool parse_elements(const std::vector<Element> &elements, bool is_dict,
+                      std::vector<JSONObject> &keys,
+                      std::vector<JSONObject> &values, size_t skip,
+                      size_t depth, size_t workers);
+
+  std::optional<JSONObject> parse_slice(size_t begin, size_t end,
+                                        const ParseOptions &parse_options) {
+    std::string_view slice = json.substr(begin, end - begin);
+    auto [value, eaten] = parse_detail<Policy>(slice, parse_options);
+    // [note]: a lenient parse leaves trailing characters uneaten
+    if (!eaten || skip_spaces(slice, eaten) != slice.size())
+      return std::nullopt;
+    return std::move(value);
+  }
+};
+
+/*
+ * [note]: the structural index of the container opening at json[open], its
+ * ',' and ':' followed by its closing bracket, empty if it doesn't close
+ * before limit
+ */
+template <typename Policy>
+std::vector<size_t> ParallelParser<Policy>::index(size_t open, size_t limit) {
+  const char *data = json.data();
+  const size_t begin = open + 1;
+  const size_t chunks =
+      std::clamp<size_t>((limit - begin) / options.min_chunk, 1, threads);
+  std::vector<size_t> bounds(chunks + 1);
+  for (size_t i = 0; i <= chunks; ++i)
+    bounds[i] = begin + (limit - begin) * i / chunks;
+
+  /*** every chunk from every state ***/
+  struct Transition {
+    ScanState state;
+    long depth;
+  };
+  std::vector<std::array<Transition, scan_state_count>> transitions(chunks);
+  run_workers(chunks, [&](size_t i) {
+    // [note]: the first chunk starts right after the bracket, outside strings
+    const size_t states = i ? scan_state_count : 1;
+    for (size_t s = 0; s < states; ++s) {
+      long depth = 0;
+      ScanState state =
+          scan_chunk<false>(data, bounds[i], bounds[i + 1],
+                            static_cast<ScanState>(s), depth, [](size_t) {});
+      transitions[i][s] = {state, depth};
+    }
+  });
+
+  /*** chain them, then collect with the real states ***/
+  std::vector<ScanState> states(chunks, ScanState::Out);
+  std::vector<long> depths(chunks, 1);
+  for (size_t i = 1; i < chunks; ++i) {
+    const Transition &prev =
+        transitions[i - 1][static_cast<size_t>(states[i - 1])];
+    states[i] = prev.state;
+    depths[i] = depths[i - 1] + prev.depth;
+  }
+  std::vector<std::vector<size_t>> found(chunks);
+  run_workers(chunks, [&](size_t i) {
+    long depth = depths[i];
+    // [note]: a chunk starting once the container is closed has nothing
+    if (depth < 1) return;
+    scan_chunk<true>(data, bounds[i], bounds[i + 1], states[i], depth,
+                     [&](size_t pos) { found[i].push_back(pos); });
+  });
+
+  std::vector<size_t> separators;
+  for (const auto &positions : found) {
+    for (size_t pos : positions) {
+      separators.push_back(pos);
+      if (json[pos] == ']' || json[pos] == '}') return separators;
+    }
+  }
+  return {};
+}
+
+template <typename Policy>
+bool ParallelParser<Policy>::parse_elements(
+    const std::vector<Element> &elements, bool is_dict,
+    std::vector<JSONObject> &keys, std::vector<JSONObject> &values,
+    size_t skip, size_t depth, size_t workers) {
+  const size_t count = elements.size();
+  // [note]: as in parse_ndjson, small enough to balance uneven elements
+  const size_t batch = std::clamp<size_t>(count / (workers * 16), 1, 64);
+  std::atomic<size_t> next{0};
+  std::atomic<bool> failed{false};
+  run_workers(workers, [&](size_t) {
+    ParseStats local;
+    ParseOptions parse_options = options.parse;
+    parse_options.max_depth -= depth;
+    parse_options.stats = options.parse.stats ? &local : nullptr;
+    parse_options.error = nullptr;
+    while (!failed.load(std::memory_order_relaxed)) {
+      size_t first = next.fetch_add(batch, std::memory_order_relaxed);
+      if (first >= count) break;
+      for (size_t i = first; i < std::min(first + batch, count); ++i) {
+        const Element &element = elements[i];
+        size_t value_begin = element.begin;
+        if (is_dict) {
+          auto key = parse_slice(element.begin, element.colon, parse_options);
+          const bool is_string =
+              key && std::holds_alternative<std::string>(key->inner);
+          if (!key || (!Policy::any_keys && !is_string)) {
+            failed = true;
+            break;
+          }
+          // [note]: parsed on its own a key counts as a string
+          if (is_string && parse_options.stats) {
+            --local.strings;
+            ++local.keys;
+          }
+          keys[i] = std::move(*key);
+          value_begin = element.colon + 1;
+        }
+        if (i == skip) continue;
+        auto value = parse_slice(value_begin, element.end, parse_options);
+        if (!value) {
+          failed = true;
+          break;
+        }
+        values[i] = std::move(*value);
+      }
+    }
+    if (options.parse.stats) {
+      // [note]: the elements were parsed as roots, `depth` levels up
+      local.max_depth += depth;
+      std::lock_guard<std::mutex> lock{stats_mutex};
+      stats += local;
+    }
+  });
+  return !failed;
+}
+
+template <typename Policy>
+std::optional<std::pair<JSONObject, size_t>> ParallelParser<Policy>::split(
+    size_t open, size_t limit, size_t depth) {
+  if (depth > options.parse.max_depth) return std::nullopt;
+  const bool is_dict = json[open] == '{';
+  std::vector<size_t> separators = index(open, limit);
+  if (separators.empty() || json[separators.back()] != (is_dict ? '}' : ']'))
+    return std::nullopt;
+  const size_t close = separators.back();
+
+  /*** cut into elements ***/
+  // [note]: empty values and trailing commas give empty elements which fail
+  // to parse, so the sequential parse handles them
+  constexpr size_t none = std::string_view::npos;
+  std::vector<Element> elements;
+  size_t begin = open + 1, colon = none;
+  for (size_t pos : separators) {
+    if (json[pos] == ':') {
+      if (!is_dict || colon != none) return std::nullopt;
+      colon = pos;
+      continue;
+    }
+    if (is_dict && colon == none) return std::nullopt;
+    elements.push_back({begin, colon, pos});
+    begin = pos + 1;
+    colon = none;
+  }
+
+  /*** descend into a dominant element, or spread the elements ***/
+  const size_t count = elements.size();
+  std::vector<JSONObject> keys(is_dict ? count : 0), values(count);
+  size_t skip = none;
+  auto value_begin = [&](const Element &element) {
+    return is_dict ? element.colon + 1 : element.begin;
+  };
+  auto largest = std::max_element(
+      elements.begin(), elements.end(), [&](const auto &a, const auto &b) {
+        return a.end - value_begin(a) < b.end - value_begin(b);
+      });
+  if (2 * (largest->end - value_begin(*largest)) > close - open) {
+    const size_t from = value_begin(*largest), to = largest->end;
+    const size_t child = skip_spaces(json.substr(0, to), from);
+    if (child < to && (json[child] == '[' || json[child] == '{') &&
+        spaces_only<Policy>(json.substr(from, child - from))) {
+      auto inner = split(child, to, depth + 1);
+      if (!inner ||
+          !spaces_only<Policy>(json.substr(inner->second, to - inner->second)))
+        return std::nullopt;
+      skip = largest - elements.begin();
+      values[skip] = std::move(inner->first);
+    }
+  }
+  // [note]: what is left beside a dominant element is parsed right here
+  if (!parse_elements(elements, is_dict, keys, values, skip, depth,
+                      skip == none ? threads : 1))
+    return std::nullopt;
+  if (options.parse.stats) {
+    ++(is_dict ? stats.dicts : stats.lists);
+    stats.max_depth = std::max(stats.max_depth, depth);
+  }
+
+  /*** assemble in input order ***/
+  JSONObject result;
+  if (is_dict) {
+    JSONDict dict;
+    dict.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+      dict.insert_or_assign(std::move(keys[i]), std::move(values[i]));
+    result.inner = std::move(dict);
+  } else {
+    result.inner = JSONList(std::make_move_iterator(values.begin()),
+                            std::make_move_iterator(values.end()));
+  }
+  return std::pair{std::move(result), close + 1};
+}
+
+template <typename Policy>
+std::pair<JSONObject, size_t> parse_parallel_detail(
+    std::string_view json, const ParallelOptions &options) {
+  const size_t threads =
+      options.threads ? options.threads
+                      : std::max(1u, std::thread::hardware_concurrency());
+  const size_t open = skip_spaces(json, 0);
+  if (threads > 1 && json.size() >= options.min_size && open < json.size() &&
+      (json[open] == '[' || json[open] == '{') &&
+      spaces_only<Policy>(json.substr(0, open))) {
+    ParallelParser<Policy> parser{json, options, threads};
+    if (auto result = parser.split(open, json.size(), 1)) {
+      size_t eaten = result->second;
+      // [note]: what parse_sax eats after the root, see trailing_text
+      if constexpr (!Policy::trailing_text)
+        eaten = spaces_only<Policy>(json.substr(eaten)) ? json.size() : 0;
+      if (eaten) {
+        if (options.parse.stats) *options.parse.stats += parser.stats;
+        if (options.parse.error) *options.parse.error = ParseError{};
+        return {std::move(result->first), eaten};
+      }
+    }
+  }
+  return parse_detail<Policy>(json, options.parse);
+}
+
+template <typename Policy>
+JSONObject parse_parallel(std::string_view json,
+                          const ParallelOptions &options) {
+  return parse_parallel_detail<Policy>(json, options).first;
+}
+
+// [note]: both policies, parallel.h declares the templates without bodies
+template std::pair<JSONObject, size_t> parse_parallel_detail<LenientPolicy>(
+    std::string_view json, const ParallelOptions &options);
+template std::pair<JSONObject, size_t> parse_parallel_detail<StrictPolicy>(
+    std::string_view json, const ParallelOptions &options);
+template JSONObject parse_parallel<LenientPolicy>(
+    std::string_view json, const ParallelOptions &options);
+template JSONObject parse_parallel<StrictPolicy>(
+    std::string_view json, const ParallelOptions &options);
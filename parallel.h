@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+
+#include "parser.h"
+#include "simpleJSON.h"
+
+struct ParallelOptions {
+  // [note]: the most threads one document is split across, 0 is one per core
+  unsigned threads = 0;
+  // [note]: smaller input is parsed by parse_detail right away, splitting
+  // doesn't pay for itself below a few hundred KB
+  size_t min_size = 1 << 20;
+  // [note]: the index is scanned in chunks of at least that many bytes,
+  // smaller ones aren't worth a thread
+  size_t min_chunk = 64 * 1024;
+  ParseOptions parse;
+};
+
+/*
+ * [note]: parse_detail of one large document on several cores, with the same
+ * result and the same eaten
+ * 1. a structural index: the input is cut into one chunk per thread and each
+ *    chunk is scanned once from every string state it may start in (outside,
+ *    inside a '"' or '\'' string, right after a '\\' there), chaining the
+ *    chunks in order tells the real state and depth each starts with, then a
+ *    second parallel scan collects the ',' and ':' of the container being
+ *    split and where it closes
+ * 2. the elements between those separators are parsed by a pool of workers
+ *    taking batches of consecutive elements, and moved into the container in
+ *    input order
+ * the root list/dict is split, unless its largest element is a list/dict
+ * holding most of the input, e.g. {"meta": ..., "data": [...]}, which is
+ * split instead while the rest is parsed beside it, and so on down
+ * anything unusual (a bad format, empty values, a key the policy refuses) is
+ * left to a sequential parse_detail of the whole input, so errors, partial
+ * results and ParseOptions::error are exactly the sequential ones
+ * ParseOptions::stats are merged from the workers, only the allocation
+ * counts of the split containers differ since they are reserved up front
+ */
+template <typename Policy = LenientPolicy>
+std::pair<JSONObject, size_t> parse_parallel_detail(
+    std::string_view json, const ParallelOptions &options = {});
+
+template <typename Policy = LenientPolicy>
+JSONObject parse_parallel(std::string_view json,
+                          const ParallelOptions &options = {});
@@ -0,0 +1,472 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "scanner.h"
+
+/*
+ * [note]: what a parse went through, filled only when ParseOptions::stats
+ * points to it, the counts accumulate so several parses can share one
+ * - values by type, dict string keys are counted apart from other strings
+ * - string bytes the result copies vs keeps as views of the input, and the
+ *   heap allocations (count and bytes) made for the result by the builders of
+ *   parse_detail and JSONDocument, the scratch stacks and the index of large
+ *   dicts aside, a SAX handler of your own reports none of these
+ * - time spent scanning and handling numbers, strings and containers, only
+ *   measured here since it costs two clock reads per value
+ */
+struct ParseStats {
+  size_t nulls = 0, bools = 0, ints = 0, doubles = 0, strings = 0, keys = 0,
+         lists = 0, dicts = 0;
+  size_t max_depth = 0;
+  size_t copied_bytes = 0, viewed_bytes = 0, escapes = 0;
+  size_t allocations = 0, allocated_bytes = 0;
+  std::chrono::nanoseconds number_time{}, string_time{}, container_time{};
+
+  void add_allocation(size_t bytes) {
+    ++allocations;
+    allocated_bytes += bytes;
+  }
+  ParseStats &operator+=(const ParseStats &other);
+};
+
+inline ParseStats &ParseStats::operator+=(const ParseStats &other) {
+  nulls += other.nulls;
+  bools += other.bools;
+  ints += other.ints;
+  doubles += other.doubles;
+  strings += other.strings;
+  keys += other.keys;
+  lists += other.lists;
+  dicts += other.dicts;
+  max_depth = std::max(max_depth, other.max_depth);
+  copied_bytes += other.copied_bytes;
+  viewed_bytes += other.viewed_bytes;
+  escapes += other.escapes;
+  allocations += other.allocations;
+  allocated_bytes += other.allocated_bytes;
+  number_time += other.number_time;
+  string_time += other.string_time;
+  container_time += other.container_time;
+  return *this;
+}
+
+/*
+ * [note]: why a parse failed, ParseError tells where, the ones marked strict
+ * are only reported by a StrictPolicy parse
+ */
+enum class ParseErrorCode : char {
+  None,
+  UnexpectedEnd,         // the input ends before the value does
+  ExpectedValue,         // no value starts with this character
+  ExpectedKey,           // strict, a dict key must be a string
+  ExpectedColon,         // after a dict key
+  ExpectedCommaOrClose,  // after a list element or dict value
+  TrailingComma,         // strict, a ',' right before ']' or '}'
+  InvalidNumber,         // e.g. '-', strict also +1, 01, .5, 1. and 1e
+  UnterminatedString,    // the input ends inside a string
+  ControlCharacter,      // strict, unescaped inside a string
+  InvalidEscape,         // strict, not one of \" \\ \/ \b \f \n \r \t \uXXXX
+  InvalidUTF8,           // strict, inside a string
+  TrailingCharacters,    // strict, anything but spaces after the value
+  TooDeep,               // more nested than ParseOptions::max_depth
+  TooLarge,              // a JSONDocument string, list or dict beyond 4G
+  TypeMismatch,          // from_json, the value doesn't fit the C++ type
+  Stopped,               // the handler returned false
+};
+
+inline const char *describe(ParseErrorCode code) {
+  switch (code) {
+    case ParseErrorCode::None:
+      return "no error";
+    case ParseErrorCode::UnexpectedEnd:
+      return "unexpected end of input";
+    case ParseErrorCode::ExpectedValue:
+      return "expected a value";
+    case ParseErrorCode::ExpectedKey:
+      return "expected a string key";
+    case ParseErrorCode::ExpectedColon:
+      return "expected ':'";
+    case ParseErrorCode::ExpectedCommaOrClose:
+      return "expected ',' or a closing bracket";
+    case ParseErrorCode::TrailingComma:
+      return "trailing comma";
+    case ParseErrorCode::InvalidNumber:
+      return "invalid number";
+    case ParseErrorCode::UnterminatedString:
+      return "unterminated string";
+    case ParseErrorCode::ControlCharacter:
+      return "unescaped control character";
+    case ParseErrorCode::InvalidEscape:
+      return "invalid escape sequence";
+    case ParseErrorCode::InvalidUTF8:
+      return "invalid UTF-8";
+    case ParseErrorCode::TrailingCharacters:
+      return "trailing characters";
+    case ParseErrorCode::TooDeep:
+      return "nested too deep";
+    case ParseErrorCode::TooLarge:
+      return "string or container too large";
+    case ParseErrorCode::TypeMismatch:
+      return "type mismatch";
+    case ParseErrorCode::Stopped:
+      return "stopped by the handler";
+  }
+  return "unknown error";
+}
+
+/*
+ * [note]: where a parse failed, `offset` is the byte index of the culprit in
+ * the input, or its size when it ends too early, `line` and `column` count
+ * from 1 and the column in bytes, code None means no error
+ */
+struct ParseError {
+  ParseErrorCode code = ParseErrorCode::None;
+  size_t offset = 0, line = 0, column = 0;
+
+  bool ok() const { return code == ParseErrorCode::None; }
+};
+
+// [note]: lines are only counted once something failed
+inline ParseError locate_error(std::string_view json, ParseErrorCode code,
+                               size_t offset) {
+  ParseError error{code, offset, 1, offset + 1};
+  for (size_t i = 0; i < offset; ++i) {
+    if (json[i] != '\n') continue;
+    ++error.line;
+    error.column = offset - i;
+  }
+  return error;
+}
+
+class JSONKeyTable;
+
+struct ParseOptions {
+  // [note]: the maximum number of nested lists/dicts, deeper input fails
+  // instead of exhausting anything
+  size_t max_depth = 1024;
+  // [note]: the \xhh and \ooo escapes, not JSON but accepted by default
+  bool escape_extensions = true;
+  // [note]: statistics are collected only if set, a null check per value
+  // otherwise, not thread safe, parse_ndjson merges per worker stats itself
+  ParseStats *stats = nullptr;
+  // [note]: set to what went wrong if set, or to no error on success, not
+  // thread safe either, parse_ndjson reports failures per record instead
+  ParseError *error = nullptr;
+  // [note]: dict keys of a JSONDocument are interned there if set, see
+  // JSONKeyTable, JSONObject trees keep their own std::string keys
+  JSONKeyTable *keys = nullptr;
+};
+
+/*
+ * [note]: the grammar parse_sax accepts, chosen at compile time so that a
+ * policy pays nothing for the checks it doesn't make
+ * LenientPolicy keeps every compatibility of the recursive parser, the
+ * default, StrictPolicy accepts RFC 8259 JSON texts only, custom policies may
+ * mix them, e.g. strict but with trailing commas
+ */
+struct LenientPolicy {
+  static constexpr bool single_quotes = true;  // 'string'
+  static constexpr bool loose_numbers = true;  // +1 01 .5 1. 1e
+  static constexpr bool empty_values = true;   // [1, , 2] [1, 2,] {"a": 1,}
+  static constexpr bool any_keys = true;       // {1: "one"}
+  // [note]: control characters, bad UTF-8 and the escapes beyond JSON
+  static constexpr bool loose_strings = true;
+  static constexpr bool extra_spaces = true;   // \f and \v
+  static constexpr bool trailing_text = true;  // left uneaten after the value
+};
+
+struct StrictPolicy {
+  static constexpr bool single_quotes = false;
+  static constexpr bool loose_numbers = false;
+  static constexpr bool empty_values = false;
+  static constexpr bool any_keys = false;
+  static constexpr bool loose_strings = false;
+  static constexpr bool extra_spaces = false;
+  static constexpr bool trailing_text = false;
+};
+
+/*
+ * [note]: SAX-style handler protocol, parse_sax tokenizes the input and calls
+ *   on_null() on_bool(bool) on_int(int) on_double(double)
+ *   on_string(std::string_view) on_key(std::string_view)
+ *   start_array() end_array() start_object() end_object()
+ * dict entries come as key value key value ..., a string key comes through
+ * on_key, but as any JSON value can be a key here, a non-string key comes
+ * through the usual events, string views are only valid during the call
+ *
+ * handlers are template parameters, so the calls are resolved at compile time
+ * and inlined, a method may return bool instead of void, returning false stops
+ * the parse right away, e.g. once the needed fields are found
+ * JSONHandler provides do-nothing defaults, derive from it and only define the
+ * events you care about
+ */
+struct JSONHandler {
+  void on_null() {}
+  void on_bool(bool) {}
+  void on_int(int) {}
+  void on_double(double) {}
+  void on_string(std::string_view) {}
+  void on_key(std::string_view) {}
+  void start_array() {}
+  void end_array() {}
+  void start_object() {}
+  void end_object() {}
+};
+
+// [note]: runs one handler call, false if the handler asked to stop
+template <typename Event>
+bool sax_emit(Event &&event) {
+  if constexpr (std::is_void_v<std::invoke_result_t<Event>>) {
+    event();
+    return true;
+  } else {
+    return event();
+  }
+}
+
+/*
+ * [note]: what parse_sax allocates for itself, the container stack and the
+ * buffer escaped strings are decoded to, passing the same scratch to one
+ * parse after another keeps their capacity, see JSONParser
+ */
+struct ParseScratch {
+  // [note]: Dict means a key is expected or being parsed, Entry means a value
+  // is expected or being parsed after the ':'
+  enum class Frame : char { List, Dict, Entry };
+  std::vector<Frame> stack;
+  std::string buffer;
+
+  size_t capacity() const { return stack.capacity() + buffer.capacity(); }
+};
+
+/*
+ * [note]: the parse engine, a loop with an explicit container stack instead of
+ * one recursive call per nesting level, see JSONHandler for the events
+ * returns the characters eaten, 0 indicates a bad format (or a handler that
+ * stopped the parse), in which case the handler has seen everything before
+ * and ParseOptions::error tells why and where
+ *
+ * compatibilities kept from the recursive parser, see LenientPolicy:
+ * - leading spaces are skipped, trailing characters are left uneaten
+ * - single quoted strings, '+', '.' and zeros prefixed numbers
+ * - trailing comma before ']' or '}'
+ * - an empty list element or dict value directly followed by ',' is null
+ * with StrictPolicy the whole input must be one JSON text, spaces around it
+ * included in what is eaten
+ *
+ * a bare JSONHandler receives nothing, so with StrictPolicy its strings are
+ * only checked and its numbers only matched, never decoded or converted
+ */
+template <typename Policy = LenientPolicy, typename Handler>
+size_t parse_sax(std::string_view json, Handler &handler,
+                 const ParseOptions &options, ParseScratch &scratch) {
+  using Frame = ParseScratch::Frame;
+  constexpr bool check_only = std::is_same_v<Handler, JSONHandler>;
+  std::vector<Frame> &stack = scratch.stack;
+  std::string &buffer = scratch.buffer;
+  stack.clear();
+  const size_t size = json.size();
+  size_t pos = 0;
+  bool after_comma = false;  // a ',' was the last separator
+  ParseStats *const stats = options.stats;
+  using clock = std::chrono::steady_clock;
+  clock::time_point start;
+  if (options.error) *options.error = ParseError{};
+  auto fail = [&](ParseErrorCode code, size_t at) -> size_t {
+    if (options.error) *options.error = locate_error(json, code, at);
+    return 0;
+  };
+  // [note]: the kernel also skips \f and \v, the first of them, if any, is
+  // left to fail as an unexpected character
+  auto skip = [&](size_t from) {
+    size_t to = skip_spaces(json, from);
+    if constexpr (!Policy::extra_spaces) {
+      for (size_t i = from; i < to; ++i)
+        if (json[i] == '\f' || json[i] == '\v') return i;
+    }
+    return to;
+  };
+  // [note]: both return false if the handler stops the parse
+  auto open = [&](char c) {
+    if (stats) {
+      ++(c == '[' ? stats->lists : stats->dicts);
+      stats->max_depth = std::max(stats->max_depth, stack.size() + 1);
+    }
+    after_comma = false;
+    if (c == '[') {
+      stack.push_back(Frame::List);
+      return sax_emit([&] { return handler.start_array(); });
+    }
+    stack.push_back(Frame::Dict);
+    return sax_emit([&] { return handler.start_object(); });
+  };
+  auto close = [&](Frame frame) {
+    stack.pop_back();
+    if (frame == Frame::List)
+      return sax_emit([&] { return handler.end_array(); });
+    return sax_emit([&] { return handler.end_object(); });
+  };
+  for (;;) {
+    /*** parse a single value or open a container ***/
+    pos = skip(pos);
+    if (pos >= size) return fail(ParseErrorCode::UnexpectedEnd, pos);
+    const char c = json[pos];
+    const Frame top = stack.empty() ? Frame::List : stack.back();
+    bool go = true;
+    if (stats) start = clock::now();
+    if (!stack.empty() && c == ',' && top != Frame::Dict) {
+      if constexpr (!Policy::empty_values)
+        return fail(ParseErrorCode::ExpectedValue, pos);
+      if (stats) ++stats->nulls;
+      go = sax_emit([&] { return handler.on_null(); });
+    } else if (!stack.empty() && c == (top == Frame::List ? ']' : '}') &&
+               top != Frame::Entry) {
+      // [note]: empty container or trailing comma
+      if constexpr (!Policy::empty_values) {
+        if (after_comma) return fail(ParseErrorCode::TrailingComma, pos);
+      }
+      ++pos;
+      go = close(top);
+      if (stats) stats->container_time += clock::now() - start;
+    } else if (!Policy::any_keys && !stack.empty() && top == Frame::Dict &&
+               c != '"') {
+      return fail(ParseErrorCode::ExpectedKey, pos);
+    } else if (c == '[' || c == '{') {
+      if (stack.size() >= options.max_depth)
+        return fail(ParseErrorCode::TooDeep, pos);
+      if (!open(c)) return fail(ParseErrorCode::Stopped, pos);
+      ++pos;
+      if (stats) stats->container_time += clock::now() - start;
+      continue;
+    } else if (c == '"' || (Policy::single_quotes && c == '\'')) {
+      StringToken str;
+      if constexpr (Policy::loose_strings) {
+        str = scan_string(json.substr(pos), buffer, options.escape_extensions);
+      } else {
+        // [note]: a valid string decodes the same with or without extensions
+        StringCheck check = check_string(json.substr(pos));
+        if (!check.eaten) return fail(check.code, pos + check.error);
+        if (check_only || !check.escaped)
+          str = {json.substr(pos + 1, check.eaten - 2), check.escaped,
+                 check.eaten};
+        else
+          str = scan_string(json.substr(pos, check.eaten), buffer, false);
+      }
+      const bool is_key = !stack.empty() && top == Frame::Dict;
+      if (is_key)
+        go = sax_emit([&] { return handler.on_key(str.value); });
+      else
+        go = sax_emit([&] { return handler.on_string(str.value); });
+      if (str.eaten == 0) return fail(ParseErrorCode::UnterminatedString, pos);
+      if (stats) {
+        ++(is_key ? stats->keys : stats->strings);
+        // [note]: every '\\' of the source starts one escape sequence
+        for (size_t i = pos; str.escaped && i < pos + str.eaten; ++i) {
+          if (json[i] != '\\') continue;
+          ++stats->escapes;
+          ++i;
+        }
+        stats->string_time += clock::now() - start;
+      }
+      pos += str.eaten;
+    } else if (json.compare(pos, 4, "null") == 0) {
+      if (stats) ++stats->nulls;
+      go = sax_emit([&] { return handler.on_null(); });
+      pos += 4;
+    } else if (json.compare(pos, 4, "true") == 0) {
+      if (stats) ++stats->bools;
+      go = sax_emit([&] { return handler.on_bool(true); });
+      pos += 4;
+    } else if (json.compare(pos, 5, "false") == 0) {
+      if (stats) ++stats->bools;
+      go = sax_emit([&] { return handler.on_bool(false); });
+      pos += 5;
+    } else {
+      NumberToken num;
+      if constexpr (Policy::loose_numbers) {
+        num = scan_number(json.substr(pos));
+      } else if (size_t length = match_number(json.substr(pos));
+                 length && check_only) {
+        num.eaten = length;
+      } else if (length) {
+        num = scan_number(json.substr(pos, length));
+      }
+      if (!num.eaten) {
+        const bool number = ('0' <= c && c <= '9') || c == '-' ||
+                            c == '+' || c == '.';
+        return fail(number ? ParseErrorCode::InvalidNumber
+                           : ParseErrorCode::ExpectedValue,
+                    pos);
+      }
+      if (num.is_int)
+        go = sax_emit([&] { return handler.on_int(num.int_value); });
+      else
+        go = sax_emit([&] { return handler.on_double(num.double_value); });
+      pos += num.eaten;
+      if (stats) {
+        ++(num.is_int ? stats->ints : stats->doubles);
+        stats->number_time += clock::now() - start;
+      }
+    }
+    if (!go) return fail(ParseErrorCode::Stopped, pos);
+    /*** after a value, consume separators and close finished containers ***/
+    for (;;) {
+      if (stack.empty()) {
+        if constexpr (Policy::trailing_text) return pos;
+        pos = skip(pos);
+        if (pos != size) return fail(ParseErrorCode::TrailingCharacters, pos);
+        return pos;
+      }
+      pos = skip(pos);
+      if (pos >= size) return fail(ParseErrorCode::UnexpectedEnd, pos);
+      const char sep = json[pos];
+      Frame &frame = stack.back();
+      if (frame == Frame::Dict) {
+        if (sep != ':') return fail(ParseErrorCode::ExpectedColon, pos);
+        ++pos;
+        frame = Frame::Entry;
+        break;
+      }
+      if (sep == ',') {
+        ++pos;
+        after_comma = true;
+        if (frame == Frame::Entry) frame = Frame::Dict;
+        break;
+      }
+      if (sep != (frame == Frame::List ? ']' : '}'))
+        return fail(ParseErrorCode::ExpectedCommaOrClose, pos);
+      ++pos;
+      if (stats) start = clock::now();
+      if (!close(frame)) return fail(ParseErrorCode::Stopped, pos);
+      if (stats) stats->container_time += clock::now() - start;
+    }
+  }
+}
+
+template <typename Policy = LenientPolicy, typename Handler>
+size_t parse_sax(std::string_view json, Handler &handler,
+                 const ParseOptions &options = {}) {
+  ParseScratch scratch;
+  return parse_sax<Policy>(json, handler, options, scratch);
+}
+
+/*
+ * [note]: checks json against the policy, RFC 8259 by default, without
+ * building any value, the fastest way to reject bad input before parsing it
+ * for real, options.error is ignored, the error is returned instead
+ */
+template <typename Policy = StrictPolicy>
+ParseError validate(std::string_view json, const ParseOptions &options = {}) {
+  ParseError error;
+  ParseOptions checking = options;
+  checking.error = &error;
+  JSONHandler handler;
+  parse_sax<Policy>(json, handler, checking);
+  return error;
+}
@@ -0,0 +1,178 @@
+#include "query.h"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <type_traits>
+
+std::optional<JSONPath> JSONPath::compile(std::string_view path) {
+  JSONPath result;
+  const size_t size = path.size();
+  size_t pos = !path.empty() && path[0] == '$';
+  while (pos < size) {
+    // [note]: without the '$' the first name needs no '.' either
+    if (path[pos] == '.' || (pos == 0 && path[0] != '[')) {
+      if (path[pos] == '.') ++pos;
+      size_t end = std::min(path.find_first_of(".[", pos), size);
+      std::string_view name = path.substr(pos, end - pos);
+      if (name.empty()) return std::nullopt;
+      if (name == "*")
+        result.steps.push_back(
+            {Step::Kind::Wildcard, {}, 0, std::string_view::npos});
+      else
+        result.add_key(std::string{name}, Step::Kind::Key);
+      pos = end;
+      continue;
+    }
+    if (path[pos] != '[' || ++pos == size) return std::nullopt;
+    if (path[pos] == '\'' || path[pos] == '"') {
+      const char quote = path[pos++];
+      std::string key;
+      for (; pos < size && path[pos] != quote; ++pos) {
+        if (path[pos] == '\\' && pos + 1 < size) ++pos;
+        key += path[pos];
+      }
+      if (pos++ == size) return std::nullopt;
+      result.add_key(std::move(key), Step::Kind::Key);
+    } else if (path[pos] == '*') {
+      result.steps.push_back(
+          {Step::Kind::Wildcard, {}, 0, std::string_view::npos});
+      ++pos;
+    } else {
+      Step step{Step::Kind::Index, {}, 0, std::string_view::npos};
+      auto [end, ec] =
+          std::from_chars(path.data() + pos, path.data() + size, step.index);
+      if (ec != std::errc{}) return std::nullopt;
+      pos = end - path.data();
+      result.steps.push_back(std::move(step));
+    }
+    if (pos == size || path[pos++] != ']') return std::nullopt;
+  }
+  return result;
+}
+
+std::optional<JSONPath> JSONPath::from_pointer(std::string_view pointer) {
+  JSONPath result;
+  if (pointer.empty()) return result;
+  if (pointer[0] != '/') return std::nullopt;
+  for (size_t pos = 1;;) {
+    size_t end = std::min(pointer.find('/', pos), pointer.size());
+    std::string key;
+    for (size_t i = pos; i < end; ++i) {
+      if (pointer[i] != '~') {
+        key += pointer[i];
+        continue;
+      }
+      if (i + 1 == end || (pointer[i + 1] != '0' && pointer[i + 1] != '1'))
+        return std::nullopt;
+      key += pointer[++i] == '0' ? '~' : '/';
+    }
+    result.add_key(std::move(key), Step::Kind::Member);
+    if (end == pointer.size()) return result;
+    pos = end + 1;
+  }
+}
+
+void JSONPath::add_key(std::string key, Step::Kind kind) {
+  Step &step = steps.emplace_back();
+  step.kind = kind;
+  step.hash = hash_string(key);
+  // [note]: RFC 6901 array indexes have no leading zeros, "-" never matches
+  const char *begin = key.data(), *end = begin + key.size();
+  if (kind == Step::Kind::Member && !key.empty() &&
+      (key[0] != '0' || key.size() == 1)) {
+    size_t index;
+    auto [ptr, ec] = std::from_chars(begin, end, index);
+    if (ec == std::errc{} && ptr == end) step.index = index;
+  }
+  step.key = std::move(key);
+}
+
+// [note]: depth first over the steps, fn returns false to stop the walk
+template <typename Value, typename Fn>
+bool JSONPath::walk(size_t i, const Value &value, Fn &fn) const {
+  if (i == steps.size()) {
+    // [note]: a shared value is found as what it shares, at every step
+    if constexpr (std::is_same_v<Value, JSONObject>)
+      return fn(resolve(value));
+    else
+      return fn(value);
+  }
+  const Step &step = steps[i];
+  const bool all = step.kind == Step::Kind::Wildcard;
+  if constexpr (std::is_same_v<Value, JSONObject>) {
+    const JSONObject &target = resolve(value);
+    if (auto *dict = std::get_if<JSONDict>(&target.inner)) {
+      if (all) {
+        for (const auto &entry : *dict)
+          if (!walk(i + 1, entry.second, fn)) return false;
+      } else if (step.kind != Step::Kind::Index) {
+        auto it = dict->find(step.key, step.hash);
+        if (it != dict->end()) return walk(i + 1, it->second, fn);
+      }
+    } else if (auto *list = std::get_if<JSONList>(&target.inner)) {
+      if (all) {
+        for (const auto &element : *list)
+          if (!walk(i + 1, element, fn)) return false;
+      } else if (step.kind != Step::Kind::Key && step.index < list->size()) {
+        return walk(i + 1, (*list)[step.index], fn);
+      }
+    }
+  } else {
+    if (auto dict = get_if<JSONNodeDict>(&value)) {
+      if (all) {
+        for (auto entry : *dict)
+          if (!walk(i + 1, entry.second, fn)) return false;
+      } else if (step.kind != Step::Kind::Index) {
+        if (const JSONNode *found = dict->find(step.key))
+          return walk(i + 1, *found, fn);
+      }
+    } else if (auto list = get_if<JSONNodeList>(&value)) {
+      if (all) {
+        for (const JSONNode &element : *list)
+          if (!walk(i + 1, element, fn)) return false;
+      } else if (step.kind != Step::Kind::Key && step.index < list->size()) {
+        return walk(i + 1, (*list)[step.index], fn);
+      }
+    }
+  }
+  return true;
+}
+
+const JSONObject *JSONPath::find(const JSONObject &root) const {
+  const JSONObject *found = nullptr;
+  auto first = [&](const JSONObject &value) {
+    found = &value;
+    return false;
+  };
+  walk(0, root, first);
+  return found;
+}
+
+const JSONNode *JSONPath::find(const JSONNode &root) const {
+  const JSONNode *found = nullptr;
+  auto first = [&](const JSONNode &value) {
+    found = &value;
+    return false;
+  };
+  walk(0, root, first);
+  return found;
+}
+
+void JSONPath::find_all(const JSONObject &root,
+                        std::vector<const JSONObject *> &out) const {
+  auto every = [&](const JSONObject &value) {
+    out.push_back(&value);
+    return true;
+  };
+  walk(0, root, every);
+}
+
+void JSONPath::find_all(const JSONNode &root,
+                        std::vector<const JSONNode *> &out) const {
+  auto every = [&](const JSONNode &value) {
+    out.push_back(&value);
+    return true;
+  };
+  walk(0, root, every);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "simpleJSON.h"
+
+/*
+ * [note]: a path compiled once into a program of steps and evaluated as many
+ * times as needed, keys are kept decoded with their hash precomputed so a
+ * lookup neither parses the path again, nor builds a JSONObject key, nor
+ * allocates anything, it works on JSONObject trees and JSONDocument nodes
+ * two syntaxes are compiled
+ * - RFC 6901 JSON Pointer: "" the root, "/a/b/3", "~0" for '~', "~1" for '/',
+ *   a token made of digits is an index in a list and a key in a dict
+ * - a small path syntax: "$.a.b[3]", "$['key with.dot']", "$.*" and "$[*]"
+ *   match every element of a list or every value of a dict, the '$' is
+ *   optional
+ */
+class JSONPath {
+ public:
+  // [note]: nullopt for a malformed path
+  static std::optional<JSONPath> compile(std::string_view path);
+  static std::optional<JSONPath> from_pointer(std::string_view pointer);
+
+  // [note]: the first match in document order, nullptr if nothing matches
+  const JSONObject *find(const JSONObject &root) const;
+  const JSONNode *find(const JSONNode &root) const;
+  // [note]: appends every match in document order, `out` can be reused
+  void find_all(const JSONObject &root,
+                std::vector<const JSONObject *> &out) const;
+  void find_all(const JSONNode &root, std::vector<const JSONNode *> &out) const;
+  size_t size() const { return steps.size(); }
+
+ private:
+  struct Step {
+    // [note]: Member is a pointer token, a key or, if numeric, an index
+    enum class Kind : char { Key, Index, Member, Wildcard };
+    Kind kind;
+    std::string key;
+    size_t hash = 0;
+    size_t index = std::string_view::npos;
+  };
+  std::vector<Step> steps;
+
+  void add_key(std::string key, Step::Kind kind);
+  template <typename Value, typename Fn>
+  bool walk(size_t i, const Value &value, Fn &fn) const;
+};
@@ -0,0 +1,573 @@
+#include "scanner.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#include "parser.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCANNER_X86
+#endif
+
+static size_t skip_spaces_scalar(const char *data, size_t pos, size_t size) {
+  while (pos < size && is_space(data[pos])) ++pos;
+  return pos;
+}
+
+static size_t find_quote_or_escape_scalar(const char *data, size_t pos,
+                                          size_t size, char quote) {
+  while (pos < size && data[pos] != quote && data[pos] != '\\') ++pos;
+  return pos;
+}
+
+static bool is_structural(char c) {
+  return c == '[' || c == ']' || c == '{' || c == '}' || c == '"' ||
+         c == '\'';
+}
+
+static size_t find_structural_scalar(const char *data, size_t pos,
+                                     size_t size) {
+  while (pos < size && !is_structural(data[pos])) ++pos;
+  return pos;
+}
+
+// [note]: control characters and bytes >= 0x80 are exactly the bytes below
+// ' ' in signed comparison
+static bool is_string_special(char c) {
+  return c == '"' || c == '\\' || static_cast<signed char>(c) < ' ';
+}
+
+static size_t find_string_special_scalar(const char *data, size_t pos,
+                                         size_t size) {
+  while (pos < size && !is_string_special(data[pos])) ++pos;
+  return pos;
+}
+
+#ifdef SCANNER_X86
+/*
+ * [note]: a byte is a space if it equals ' ' or lies in '\t'...'\r', the range
+ * check uses signed comparison so bytes >= 0x80 (negative) never match, the
+ * tails shorter than a vector fall back to the scalar loop
+ */
+__attribute__((target("sse2"))) static size_t skip_spaces_sse2(
+    const char *data, size_t pos, size_t size) {
+  const __m128i blank = _mm_set1_epi8(' '), low = _mm_set1_epi8('\t' - 1),
+                high = _mm_set1_epi8('\r' + 1);
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    __m128i space = _mm_or_si128(
+        _mm_cmpeq_epi8(chunk, blank),
+        _mm_and_si128(_mm_cmpgt_epi8(chunk, low), _mm_cmpgt_epi8(high, chunk)));
+    unsigned mask = ~_mm_movemask_epi8(space) & 0xffff;
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return skip_spaces_scalar(data, pos, size);
+}
+
+__attribute__((target("sse2"))) static size_t find_quote_or_escape_sse2(
+    const char *data, size_t pos, size_t size, char quote) {
+  const __m128i quotes = _mm_set1_epi8(quote), slash = _mm_set1_epi8('\\');
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(chunk, quotes), _mm_cmpeq_epi8(chunk, slash)));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return find_quote_or_escape_scalar(data, pos, size, quote);
+}
+
+// [note]: '[' ']' differ from '{' '}' only by the 0x20 bit, so or-ing it in
+// leaves two brackets and two quotes to compare with
+__attribute__((target("sse2"))) static size_t find_structural_sse2(
+    const char *data, size_t pos, size_t size) {
+  const __m128i bit = _mm_set1_epi8(0x20), open = _mm_set1_epi8('{'),
+                close = _mm_set1_epi8('}'), quote = _mm_set1_epi8('"'),
+                single = _mm_set1_epi8('\'');
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    __m128i folded = _mm_or_si128(chunk, bit);
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                     _mm_cmpeq_epi8(folded, close)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                     _mm_cmpeq_epi8(chunk, single))));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return find_structural_scalar(data, pos, size);
+}
+
+__attribute__((target("sse2"))) static size_t find_string_special_sse2(
+    const char *data, size_t pos, size_t size) {
+  const __m128i quote = _mm_set1_epi8('"'), slash = _mm_set1_epi8('\\'),
+                blank = _mm_set1_epi8(' ');
+  for (; pos + 16 <= size; pos += 16) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    unsigned mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                  _mm_cmpeq_epi8(chunk, slash)),
+                     _mm_cmplt_epi8(chunk, blank)));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return find_string_special_scalar(data, pos, size);
+}
+
+__attribute__((target("avx2"))) static size_t skip_spaces_avx2(
+    const char *data, size_t pos, size_t size) {
+  const __m256i blank = _mm256_set1_epi8(' '),
+                low = _mm256_set1_epi8('\t' - 1),
+                high = _mm256_set1_epi8('\r' + 1);
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    __m256i space = _mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, blank),
+        _mm256_and_si256(_mm256_cmpgt_epi8(chunk, low),
+                         _mm256_cmpgt_epi8(high, chunk)));
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(space));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  // [note]: not the SSE2 kernel, its legacy encoded instructions right after
+  // 256-bit ones stall on the upper register state, which made the short
+  // slices of parse_parallel several times slower
+  return skip_spaces_scalar(data, pos, size);
+}
+
+__attribute__((target("avx2"))) static size_t find_quote_or_escape_avx2(
+    const char *data, size_t pos, size_t size, char quote) {
+  const __m256i quotes = _mm256_set1_epi8(quote),
+                slash = _mm256_set1_epi8('\\');
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quotes),
+                        _mm256_cmpeq_epi8(chunk, slash))));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return find_quote_or_escape_scalar(data, pos, size, quote);
+}
+
+__attribute__((target("avx2"))) static size_t find_structural_avx2(
+    const char *data, size_t pos, size_t size) {
+  const __m256i bit = _mm256_set1_epi8(0x20), open = _mm256_set1_epi8('{'),
+                close = _mm256_set1_epi8('}'), quote = _mm256_set1_epi8('"'),
+                single = _mm256_set1_epi8('\'');
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    __m256i folded = _mm256_or_si256(chunk, bit);
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, open),
+                        _mm256_cmpeq_epi8(folded, close)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                        _mm256_cmpeq_epi8(chunk, single)))));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return find_structural_scalar(data, pos, size);
+}
+
+__attribute__((target("avx2"))) static size_t find_string_special_avx2(
+    const char *data, size_t pos, size_t size) {
+  const __m256i quote = _mm256_set1_epi8('"'), slash = _mm256_set1_epi8('\\'),
+                blank = _mm256_set1_epi8(' ');
+  for (; pos + 32 <= size; pos += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                        _mm256_cmpeq_epi8(chunk, slash)),
+                        _mm256_cmpgt_epi8(blank, chunk))));
+    if (mask) return pos + __builtin_ctz(mask);
+  }
+  return find_string_special_scalar(data, pos, size);
+}
+#endif
+
+// [note]: constant initialized, so the scalar kernels are usable even by other
+// static initializers running before the selection below
+ScanKernels scan_kernels{ScanLevel::Scalar, skip_spaces_scalar,
+                         find_quote_or_escape_scalar, find_structural_scalar,
+                         find_string_special_scalar};
+
+bool use_scan_level(ScanLevel level) {
+#ifdef SCANNER_X86
+  __builtin_cpu_init();  // [note]: required when run by a static initializer
+#endif
+  switch (level) {
+    case ScanLevel::Scalar:
+      scan_kernels = {level, skip_spaces_scalar, find_quote_or_escape_scalar,
+                      find_structural_scalar, find_string_special_scalar};
+      return true;
+#ifdef SCANNER_X86
+    case ScanLevel::SSE2:
+      if (!__builtin_cpu_supports("sse2")) return false;
+      scan_kernels = {level, skip_spaces_sse2, find_quote_or_escape_sse2,
+                      find_structural_sse2, find_string_special_sse2};
+      return true;
+    case ScanLevel::AVX2:
+      if (!__builtin_cpu_supports("avx2")) return false;
+      scan_kernels = {level, skip_spaces_avx2, find_quote_or_escape_avx2,
+                      find_structural_avx2, find_string_special_avx2};
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+static const bool scan_level_selected = use_scan_level(ScanLevel::AVX2) ||
+                                        use_scan_level(ScanLevel::SSE2);
+
+// [note]: what a single character escape stands for, 0 if it is not one,
+// compatible with \a and \v which are unsupported by JSON
+static constexpr std::array<char, 256> simple_escapes = [] {
+  std::array<char, 256> table{};
+  table['a'] = '\a';
+  table['b'] = '\b';
+  table['f'] = '\f';
+  table['n'] = '\n';
+  table['r'] = '\r';
+  table['t'] = '\t';
+  table['v'] = '\v';
+  return table;
+}();
+
+// [note]: the value of a hex digit, 0xff for any other byte
+static constexpr std::array<uint8_t, 256> hex_digits = [] {
+  std::array<uint8_t, 256> table{};
+  for (auto &digit : table) digit = 0xff;
+  for (int c = '0'; c <= '9'; ++c) table[c] = c - '0';
+  for (int c = 'a'; c <= 'f'; ++c) table[c] = c - 'a' + 10;
+  for (int c = 'A'; c <= 'F'; ++c) table[c] = c - 'A' + 10;
+  return table;
+}();
+
+// [note]: reads up to `max` hex digits from pos, advancing pos past them
+static uint32_t read_hex(std::string_view json, size_t &pos, int max,
+                         int &digits) {
+  uint32_t value = 0;
+  for (digits = 0; digits < max && pos < json.size(); ++digits, ++pos) {
+    uint8_t digit = hex_digits[static_cast<unsigned char>(json[pos])];
+    if (digit == 0xff) break;
+    value = value << 4 | digit;
+  }
+  return value;
+}
+
+static void write_utf8(char *&out, uint32_t cp) {
+  // [note]: surrogates and out of range code points can't be encoded
+  if ((0xd800 <= cp && cp < 0xe000) || cp > 0x10ffff) cp = 0xfffd;
+  if (cp < 0x80) {
+    *out++ = static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    *out++ = static_cast<char>(0xc0 | cp >> 6);
+    *out++ = static_cast<char>(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    *out++ = static_cast<char>(0xe0 | cp >> 12);
+    *out++ = static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3f));
+  } else {
+    *out++ = static_cast<char>(0xf0 | cp >> 18);
+    *out++ = static_cast<char>(0x80 | (cp >> 12 & 0x3f));
+    *out++ = static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+    *out++ = static_cast<char>(0x80 | (cp & 0x3f));
+  }
+}
+
+/*
+ * [note]: decodes the escape sequence whose '\\' is at json[pos - 1] to out
+ * and returns the position after it, writing 4 bytes at most
+ * - \uXXXX is a UTF-16 code unit, a high surrogate directly followed by a
+ *   \uXXXX low surrogate makes one code point, a lone one gives U+FFFD
+ * - \UXXXXXXXX is a code point
+ * - with extensions, \xhh and \ooo (up to 2 hex / 3 octal digits) are a byte
+ * - any other character stands for itself, e.g. \" \\ \/ or \g
+ * a \u or \U cut short by a non hex character decodes to nothing and that
+ * character is read as usual
+ */
+static size_t decode_escape(std::string_view json, size_t pos, char *&out,
+                            bool extensions) {
+  if (pos >= json.size()) return pos;
+  const char c = json[pos++];
+  if (char simple = simple_escapes[static_cast<unsigned char>(c)]) {
+    *out++ = simple;
+    return pos;
+  }
+  int digits;
+  if (c == 'u') {
+    uint32_t unit = read_hex(json, pos, 4, digits);
+    if (digits < 4) return pos;
+    if (0xd800 <= unit && unit < 0xdc00 && json.compare(pos, 2, "\\u") == 0) {
+      size_t low_pos = pos + 2;
+      uint32_t low = read_hex(json, low_pos, 4, digits);
+      if (digits == 4 && 0xdc00 <= low && low < 0xe000) {
+        write_utf8(out, 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00));
+        return low_pos;
+      }
+    }
+    write_utf8(out, unit);
+    return pos;
+  }
+  if (c == 'U') {
+    uint32_t cp = read_hex(json, pos, 8, digits);
+    if (digits == 8) write_utf8(out, cp);
+    return pos;
+  }
+  if (extensions && c == 'x') {
+    uint32_t byte = read_hex(json, pos, 2, digits);
+    if (digits) *out++ = static_cast<char>(byte);
+    return pos;
+  }
+  if (extensions && '0' <= c && c <= '7') {
+    uint32_t byte = c - '0';
+    for (int n = 1; n < 3 && pos < json.size(); ++n, ++pos) {
+      if (json[pos] < '0' || json[pos] > '7') break;
+      byte = byte << 3 | (json[pos] - '0');
+    }
+    *out++ = static_cast<char>(byte);
+    return pos;
+  }
+  *out++ = c;
+  return pos;
+}
+
+static bool is_digit(char c) { return '0' <= c && c <= '9'; }
+
+/*
+ * [note]: the power of ten of a number's leading digit, e.g. 2 for 123.4 and
+ * -3 for 0.0012, exponent included and saturated, its sign tells overflow from
+ * underflow once std::from_chars finds a number out of range, whatever the
+ * digits and the exponent look like on their own
+ */
+static long long decimal_magnitude(const char *p, const char *end) {
+  while (p != end && *p == '0') ++p;
+  const char *integer = p;
+  while (p != end && is_digit(*p)) ++p;
+  long long magnitude = p - integer - 1;
+  if (p != end && *p == '.') {
+    const char *fraction = ++p;
+    if (magnitude < 0) {
+      while (p != end && *p == '0') ++p;
+      magnitude = fraction - p - 1;
+    }
+    while (p != end && is_digit(*p)) ++p;
+  }
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    const bool negative = *++p == '-';
+    if (*p == '+' || *p == '-') ++p;
+    long long exponent = 0;
+    for (; p != end && is_digit(*p); ++p)
+      exponent = std::min(exponent * 10 + (*p - '0'), 1LL << 40);
+    magnitude += negative ? -exponent : exponent;
+  }
+  return magnitude;
+}
+
+/*
+ * strict JSON number: -?(0|[1-9]+[0-9]*)(\.[0-9]*)?([eE][+-]?[0-9]+)?
+ * compatible with '+', '.' and zeros prefix
+ * so the accepted grammar is [+-]?[0-9]*(\.[0-9]*)?([eE][+-]?[0-9]+)? with at
+ * least one digit before the exponent part
+ *
+ * [note]: the token is recognized in a single pass, a number without fraction
+ * and exponent part is an int unless it overflows, and the conversion uses
+ * std::from_chars which neither allocates, throws nor depends on the locale
+ */
+NumberToken scan_number(std::string_view json) {
+  const char *begin = json.data(), *end = begin + json.size(), *p = begin;
+  NumberToken token;
+  if (p != end && (*p == '+' || *p == '-')) ++p;
+  const char *digits = p;
+  while (p != end && is_digit(*p)) ++p;
+  bool has_digits = p != digits;
+  if (p != end && *p == '.') {
+    const char *fraction = ++p;
+    while (p != end && is_digit(*p)) ++p;
+    has_digits = has_digits || p != fraction;
+    token.is_int = false;
+  }
+  if (!has_digits) return NumberToken{};
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    // [note]: a dangling 'e' is not part of the number, just like the regex
+    // ([eE][+-]?[0-9]+)? used to behave
+    const char *q = p + 1;
+    if (q != end && (*q == '+' || *q == '-')) ++q;
+    const char *exponent = q;
+    while (q != end && is_digit(*q)) ++q;
+    if (q != exponent) {
+      p = q;
+      token.is_int = false;
+    }
+  }
+  // [note]: std::from_chars rejects a leading '+'
+  const char *first = *begin == '+' ? begin + 1 : begin;
+  token.eaten = p - begin;
+  if (token.is_int) {
+    auto [last, ec] = std::from_chars(first, p, token.int_value);
+    if (ec == std::errc{} && last == p) return token;
+    token.is_int = false;  // out of int range, fall back to double
+  }
+  auto [last, ec] = std::from_chars(first, p, token.double_value);
+  if (ec == std::errc::result_out_of_range) {
+    // [note]: mimic strtod, overflow gives inf and underflow gives zero
+    token.double_value = decimal_magnitude(digits, p) >= 0
+                             ? std::numeric_limits<double>::infinity()
+                             : 0.0;
+    if (*begin == '-') token.double_value = -token.double_value;
+  } else if (ec != std::errc{} || last != p) {
+    return NumberToken{};
+  }
+  return token;
+}
+
+StringToken scan_string(std::string_view json, std::string &buffer,
+                        bool extensions) {
+  const char quote = json[0];
+  const size_t size = json.size();
+  // [note]: fast path, most strings contain no escape and can be returned as a
+  // view of the source
+  size_t i = find_quote_or_escape(json, 1, quote);
+  if (i == size) return {json.substr(1), false, 0};
+  if (json[i] == quote) return {json.substr(1, i - 1), false, i + 1};
+  // [note]: the decoded text is written through a pointer, `buffer` only grows
+  // and keeps its size across calls so resize() zero fills it once, json[i] is
+  // a quote or a '\\', escapes are decoded in place and the runs of plain
+  // characters between them are copied at once
+  size_t used = 0;
+  auto room = [&](size_t bytes) {
+    if (used + bytes > buffer.size())
+      buffer.resize(std::max(buffer.size() * 2, used + bytes));
+    return buffer.data() + used;
+  };
+  std::memcpy(room(i - 1), json.data() + 1, i - 1);
+  used += i - 1;
+  while (i < size && json[i] != quote) {
+    // [note]: an escape decodes to 4 bytes at most
+    char *out = room(4);
+    i = decode_escape(json, i + 1, out, extensions);
+    used = out - buffer.data();
+    // [note]: back to back escapes are common (e.g. \uXXXX pairs), the kernel
+    // call is skipped when the next one starts right away
+    if (i < size && (json[i] == '\\' || json[i] == quote)) continue;
+    size_t run = find_quote_or_escape(json, i, quote);
+    std::memcpy(room(run - i), json.data() + i, run - i);
+    used += run - i;
+    i = run;
+  }
+  return {{buffer.data(), used}, true, i < size ? i + 1 : 0};
+}
+
+/*
+ * [note]: the length of the well-formed UTF-8 sequence at json[pos], 0 for an
+ * invalid one, overlong forms, surrogates and code points above U+10FFFF are
+ * rejected by narrowing the range of the second byte (RFC 3629)
+ */
+static size_t utf8_sequence(std::string_view json, size_t pos) {
+  const auto byte = [&](size_t i) -> unsigned {
+    return pos + i < json.size() ? static_cast<unsigned char>(json[pos + i])
+                                 : 0;
+  };
+  const unsigned lead = byte(0);
+  size_t length;
+  unsigned low = 0x80, high = 0xbf;
+  if (0xc2 <= lead && lead <= 0xdf) {
+    length = 2;
+  } else if (0xe0 <= lead && lead <= 0xef) {
+    length = 3;
+    if (lead == 0xe0) low = 0xa0;
+    if (lead == 0xed) high = 0x9f;
+  } else if (0xf0 <= lead && lead <= 0xf4) {
+    length = 4;
+    if (lead == 0xf0) low = 0x90;
+    if (lead == 0xf4) high = 0x8f;
+  } else {
+    return 0;
+  }
+  if (byte(1) < low || byte(1) > high) return 0;
+  for (size_t i = 2; i < length; ++i)
+    if ((byte(i) & 0xc0) != 0x80) return 0;
+  return length;
+}
+
+StringCheck check_string(std::string_view json) {
+  const size_t size = json.size();
+  StringCheck check;
+  auto fail = [&](ParseErrorCode code, size_t pos) {
+    check.code = code;
+    check.error = pos;
+    return check;
+  };
+  size_t i = 1;
+  for (;;) {
+    i = find_string_special(json, i);
+    if (i == size) return fail(ParseErrorCode::UnterminatedString, 0);
+    const char c = json[i];
+    if (c == '"') {
+      check.eaten = i + 1;
+      return check;
+    }
+    if (c == '\\') {
+      check.escaped = true;
+      const char e = i + 1 < size ? json[i + 1] : '\0';
+      if (e == 'u') {
+        for (size_t k = i + 2; k < i + 6; ++k)
+          if (k >= size || hex_digits[static_cast<unsigned char>(json[k])] ==
+                               0xff)
+            return fail(ParseErrorCode::InvalidEscape, i);
+        i += 6;
+      } else if (e == '"' || e == '\\' || e == '/' ||
+                 (e != 'a' && e != 'v' &&
+                  simple_escapes[static_cast<unsigned char>(e)])) {
+        i += 2;
+      } else {
+        return fail(ParseErrorCode::InvalidEscape, i);
+      }
+      continue;
+    }
+    if (static_cast<unsigned char>(c) < 0x20)
+      return fail(ParseErrorCode::ControlCharacter, i);
+    // [note]: non-ASCII text tends to come in runs, check them all before
+    // going back to the kernel
+    do {
+      size_t length = utf8_sequence(json, i);
+      if (!length) return fail(ParseErrorCode::InvalidUTF8, i);
+      i += length;
+    } while (i < size && static_cast<unsigned char>(json[i]) >= 0x80);
+  }
+}
+
+size_t match_number(std::string_view json) {
+  const size_t size = json.size();
+  size_t i = 0;
+  auto digits = [&] {
+    const size_t start = i;
+    while (i < size && is_digit(json[i])) ++i;
+    return i != start;
+  };
+  if (i < size && json[i] == '-') ++i;
+  if (i < size && json[i] == '0') {
+    if (++i < size && is_digit(json[i])) return 0;
+  } else if (!digits()) {
+    return 0;
+  }
+  if (i < size && json[i] == '.') {
+    ++i;
+    if (!digits()) return 0;
+  }
+  if (i < size && (json[i] == 'e' || json[i] == 'E')) {
+    ++i;
+    if (i < size && (json[i] == '+' || json[i] == '-')) ++i;
+    if (!digits()) return 0;
+  }
+  return i;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// [note]: JSON whitespace plus the \f and \v we have always tolerated, that is
+// ' ' and the contiguous range '\t'(9) ... '\r'(13)
+inline bool is_space(char c) { return c == ' ' || ('\t' <= c && c <= '\r'); }
+
+// [note]: a byte of a bare word, a number or null/true/false, for the
+// scanners that skip values without parsing them
+inline bool is_word(char c) {
+  return ('0' <= c && c <= '9') || ('a' <= c && c <= 'z') ||
+         ('A' <= c && c <= 'Z') || c == '+' || c == '-' || c == '.';
+}
+
+/*
+ * [note]: the byte scanning kernels behind the hot loops, a scalar version
+ * always exists, SSE2/AVX2 versions look at 16/32 bytes at a time and are
+ * picked at startup according to what the running CPU supports
+ * skip_spaces: position of the first non-space byte at or after pos
+ * find_quote_or_escape: position of the first `quote` or '\\' at or after pos
+ * find_structural: position of the first bracket or quote at or after pos
+ * find_string_special: position of the first '"', '\\', control character or
+ *   non-ASCII byte at or after pos
+ * all return `size` when there is none
+ */
+enum class ScanLevel { Scalar, SSE2, AVX2 };
+
+struct ScanKernels {
+  ScanLevel level;
+  size_t (*skip_spaces)(const char *data, size_t pos, size_t size);
+  size_t (*find_quote_or_escape)(const char *data, size_t pos, size_t size,
+                                 char quote);
+  size_t (*find_structural)(const char *data, size_t pos, size_t size);
+  size_t (*find_string_special)(const char *data, size_t pos, size_t size);
+};
+
+extern ScanKernels scan_kernels;
+
+// [note]: returns false if the CPU doesn't support the level, mainly for
+// benchmarks comparing kernels, not thread safe against running parses
+bool use_scan_level(ScanLevel level);
+
+inline size_t skip_spaces(std::string_view json, size_t pos) {
+  // [note]: a value directly following its separator is the common case, don't
+  // pay for the kernel call then
+  if (pos >= json.size() || !is_space(json[pos])) return pos;
+  return scan_kernels.skip_spaces(json.data(), pos + 1, json.size());
+}
+
+inline size_t find_quote_or_escape(std::string_view json, size_t pos,
+                                   char quote) {
+  return scan_kernels.find_quote_or_escape(json.data(), pos, json.size(),
+                                           quote);
+}
+inline size_t find_structural(std::string_view json, size_t pos) {
+  return scan_kernels.find_structural(json.data(), pos, json.size());
+}
+inline size_t find_string_special(std::string_view json, size_t pos) {
+  return scan_kernels.find_string_special(json.data(), pos, json.size());
+}
+
+/*
+ * [note]: a number token scanned straight from the input view, `eaten` is 0
+ * when the input doesn't start with a number, otherwise exactly one of
+ * int_value/double_value is meaningful according to is_int
+ */
+struct NumberToken {
+  bool is_int = true;
+  int int_value{};
+  double double_value{};
+  size_t eaten = 0;
+};
+
+NumberToken scan_number(std::string_view json);
+
+/*
+ * [note]: a quoted string token, json[0] must be the opening quote ('"' or
+ * '\''), `value` views the source directly when there is no escape at all,
+ * otherwise it views `buffer` where the decoded characters are written to
+ * `eaten` counts both quotes and is 0 for an unterminated string, in which case
+ * `value` still holds what has been read
+ * escapes are decoded straight into `buffer` as UTF-8, \uXXXX surrogate pairs
+ * included, `extensions` enables the \xhh and \ooo byte escapes
+ */
+struct StringToken {
+  std::string_view value;
+  bool escaped = false;
+  size_t eaten = 0;
+};
+
+StringToken scan_string(std::string_view json, std::string &buffer,
+                        bool extensions = true);
+
+// [note]: why a parse failed, defined in parser.h along with ParseError
+enum class ParseErrorCode : char;
+
+/*
+ * [note]: checks a '"' quoted string token against RFC 8259 without decoding
+ * it, `eaten` counts both quotes like StringToken and is 0 when the string is
+ * invalid, in which case `code` tells why and json[error] is the culprit
+ */
+struct StringCheck {
+  size_t eaten = 0;
+  bool escaped = false;
+  ParseErrorCode code{};  // None
+  size_t error = 0;
+};
+
+StringCheck check_string(std::string_view json);
+
+// [note]: the length of the RFC 8259 number json starts with, 0 if there is
+// none, a leading zero followed by digits makes no number either
+size_t match_number(std::string_view json);
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "serializer.h"
+
+#include <charconv>
+#include <cmath>
+
+#include "type.h"
+
+void write_string(std::string &out, std::string_view s) {
+  static constexpr char hex[] = "0123456789abcdef";
+  out.reserve(out.size() + s.size() + 2);
+  out += '"';
+  size_t run = 0;
+  for (size_t i = 0; i < s.size(); ++i) {
+    unsigned char c = s[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out.append(s.data() + run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:  // [note]: including \a and \v which JSON doesn't have
+        out += "\\u00";
+        out += hex[c >> 4];
+        out += hex[c & 0xf];
+        break;
+    }
+  }
+  out.append(s.data() + run, s.size() - run);
+  out += '"';
+}
+
+void JSONWriter::newline(size_t depth) {
+  out += '\n';
+  out.append(depth * options.indent, ' ');
+}
+
+void JSONWriter::before_value() {
+  if (stack.empty()) return;
+  Frame &top = stack.back();
+  if (top.is_dict && !top.at_key) return;  // the value right after ':'
+  if (!top.empty) out += ',';
+  top.empty = false;
+  if (pretty()) newline(stack.size());
+}
+
+void JSONWriter::after_value() {
+  if (stack.empty() || !stack.back().is_dict) return;
+  Frame &top = stack.back();
+  if (top.at_key) out += pretty() ? ": " : ":";
+  top.at_key = !top.at_key;
+}
+
+void JSONWriter::write_scalar(std::string_view text) {
+  before_value();
+  if (at_key()) {
+    out += '"';
+    out += text;
+    out += '"';
+  } else {
+    out += text;
+  }
+  after_value();
+}
+
+void JSONWriter::on_null() { write_scalar("null"); }
+
+void JSONWriter::on_bool(bool b) { write_scalar(b ? "true" : "false"); }
+
+void JSONWriter::on_int(int i) {
+  char buf[16];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof buf, i);
+  write_scalar({buf, static_cast<size_t>(end - buf)});
+}
+
+void JSONWriter::on_double(double d) {
+  if (!std::isfinite(d)) return write_scalar("null");
+  char buf[32];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof buf - 2, d);
+  // [note]: the shortest form of 3.0 is "3", which would be read back as int
+  if (std::string_view{buf, static_cast<size_t>(end - buf)}.find_first_of(
+          ".e") == std::string_view::npos) {
+    *end++ = '.';
+    *end++ = '0';
+  }
+  write_scalar({buf, static_cast<size_t>(end - buf)});
+}
+
+void JSONWriter::on_string(std::string_view s) {
+  before_value();
+  write_string(out, s);
+  after_value();
+}
+
+void JSONWriter::start_container(bool is_dict) {
+  before_value();
+  Frame frame{is_dict};
+  if (at_key()) {
+    frame.is_key = true;
+    frame.key_start = out.size();
+    ++keys_open;
+  }
+  out += is_dict ? '{' : '[';
+  stack.push_back(frame);
+}
+
+void JSONWriter::end_container(char close) {
+  Frame frame = stack.back();
+  stack.pop_back();
+  if (!frame.empty && pretty()) newline(stack.size());
+  out += close;
+  if (frame.is_key) {
+    --keys_open;
+    std::string text = out.substr(frame.key_start);
+    out.resize(frame.key_start);
+    write_string(out, text);
+  }
+  after_value();
+}
+
+void JSONWriter::start_array() { start_container(false); }
+
+void JSONWriter::end_array() { end_container(']'); }
+
+void JSONWriter::start_object() { start_container(true); }
+
+void JSONWriter::end_object() { end_container('}'); }
+
+void JSONWriter::on_value(const JSONObject &obj) {
+  std::visit(overloaded{[&](std::monostate) { on_null(); },
+                        [&](bool b) { on_bool(b); },
+                        [&](int i) { on_int(i); },
+                        [&](double d) { on_double(d); },
+                        [&](const std::string &s) { on_string(s); },
+                        [&](const JSONList &list) {
+                          start_array();
+                          for (const auto &element : list) on_value(element);
+                          end_array();
+                        },
+                        [&](const JSONDict &dict) {
+                          start_object();
+                          for (const auto &[key, value] : dict) {
+                            on_value(key);
+                            on_value(value);
+                          }
+                          end_object();
+                        },
+                        [&](const JSONShared &shared) {
+                          on_value(shared->value);
+                        }},
+             obj.inner);
+}
+
+void serialize(const JSONObject &obj, std::string &out,
+               const SerializeOptions &options) {
+  JSONWriter writer{out, options};
+  writer.on_value(obj);
+}
+
+std::string serialize(const JSONObject &obj, const SerializeOptions &options) {
+  std::string out;
+  serialize(obj, out, options);
+  return out;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "simpleJSON.h"
+
+struct SerializeOptions {
+  bool pretty = false;  // newline and indentation per nesting level
+  int indent = 2;
+};
+
+/*
+ * [note]: writes strict JSON into a growable buffer, it takes the same events
+ * as the builders of parse_sax so a tree, a document or even the parser
+ * itself can drive it
+ * - strings are escaped in runs, only '"', '\\' and control characters are
+ *   rewritten, other bytes (UTF-8 included) are copied as they are
+ * - numbers go through std::to_chars, doubles in their shortest round-trip
+ *   form and always with a '.' or an exponent so they are read back as double,
+ *   nan and inf are not JSON and written as null
+ * - dict keys are always quoted, a non-string key is written as the string of
+ *   its compact JSON text, e.g. {985: 1} gives {"985":1}
+ */
+class JSONWriter {
+ public:
+  explicit JSONWriter(std::string &out, const SerializeOptions &options = {})
+      : out{out}, options{options} {}
+
+  void on_null();
+  void on_bool(bool b);
+  void on_int(int i);
+  void on_double(double d);
+  void on_string(std::string_view s);
+  void on_key(std::string_view s) { on_string(s); }
+  // [note]: an already formatted number written as it is, e.g. an int64
+  void on_number(std::string_view text) { write_scalar(text); }
+  // [note]: writes a whole tree where the next event would go
+  void on_value(const JSONObject &obj);
+  void start_array();
+  void end_array();
+  void start_object();
+  void end_object();
+
+ private:
+  struct Frame {
+    bool is_dict;
+    bool empty = true;
+    bool at_key = true;  // a dict is waiting for a key rather than a value
+    bool is_key = false;   // this container itself is a dict key
+    size_t key_start = 0;  // where the key's JSON text begins in out
+  };
+  std::string &out;
+  SerializeOptions options;
+  std::vector<Frame> stack;
+  size_t keys_open = 0;  // containers being written as a key, always compact
+
+  bool pretty() const { return options.pretty && keys_open == 0; }
+  bool at_key() const {
+    return !stack.empty() && stack.back().is_dict && stack.back().at_key;
+  }
+  void newline(size_t depth);
+  void before_value();
+  void after_value();
+  void write_scalar(std::string_view text);
+  void start_container(bool is_dict);
+  void end_container(char close);
+};
+
+// [note]: appends to `out`, which can be reused across calls to keep capacity
+void serialize(const JSONObject &obj, std::string &out,
+               const SerializeOptions &options = {});
+
+std::string serialize(const JSONObject &obj,
+                      const SerializeOptions &options = {});
+
+// [note]: appends s as a quoted and escaped JSON string
+void write_string(std::string &out, std::string_view s);
\ No newline at end of file
@@ -1,28 +1,221 @@
 #include "simpleJSON.h"
 
-#include "converter.h"
+#include <algorithm>
+#include <stdexcept>
 
-char basic_escape(char c) {
-  // [note]: compatible with \a and \v which are unsupported by JSON, reserve \0
-  // for octal escape
-  switch (c) {
-    case 'a':
-      return '\a';
-    case 'b':
-      return '\b';
-    case 'f':
-      return '\f';
-    case 'n':
-      return '\n';
-    case 'r':
-      return '\r';
-    case 't':
-      return '\t';
-    case 'v':
-      return '\v';
-    default:
-      return c;
+#include "scanner.h"
+
+JSONDict::JSONDict(std::initializer_list<value_type> init) {
+  entries.reserve(init.size());
+  for (const auto &entry : init) insert(entry);
+}
+
+void JSONDict::clear() {
+  entries.clear();
+  index.clear();
+}
+
+template <typename Equal>
+size_t JSONDict::locate(size_t hash, Equal equal) const {
+  if (index.empty()) {
+    for (size_t i = 0; i < entries.size(); ++i)
+      if (equal(entries[i].first)) return i;
+    return entries.size();
   }
+  const size_t mask = index.size() - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    const Slot &s = index[slot];
+    if (s.entry == 0) return entries.size();
+    if (s.hash == static_cast<uint32_t>(hash) &&
+        equal(entries[s.entry - 1].first))
+      return s.entry - 1;
+  }
+}
+
+size_t JSONDict::locate(const JSONObject &key) const {
+  // [note]: linear search doesn't need the hash, which may walk a whole
+  // list/dict key
+  return locate(index.empty() ? 0 : JSONObjectHash{}(key),
+                [&](const JSONObject &k) { return k == key; });
+}
+
+size_t JSONDict::locate(std::string_view key) const {
+  return locate(key, index.empty() ? 0 : hash_string(key));
+}
+
+size_t JSONDict::locate(std::string_view key, size_t hash) const {
+  return locate(hash, [&](const JSONObject &k) {
+    auto *s = std::get_if<std::string>(&k.inner);
+    return s && *s == key;
+  });
+}
+
+void JSONDict::index_entry(size_t pos, size_t hash) {
+  // [note]: keep the load factor under 1/2 so probing stays short
+  if ((pos + 1) * 2 > index.size()) return rebuild_index();
+  const size_t mask = index.size() - 1;
+  size_t slot = hash & mask;
+  while (index[slot].entry != 0) slot = (slot + 1) & mask;
+  index[slot] = {static_cast<uint32_t>(pos + 1), static_cast<uint32_t>(hash)};
+}
+
+void JSONDict::rebuild_index() {
+  index.clear();
+  if (entries.size() <= linear_limit) return;
+  size_t capacity = 16;
+  while (capacity < entries.size() * 4) capacity *= 2;
+  index.resize(capacity, Slot{0, 0});
+  for (size_t i = 0; i < entries.size(); ++i)
+    index_entry(i, JSONObjectHash{}(entries[i].first));
+}
+
+std::pair<JSONDict::iterator, bool> JSONDict::insert(value_type entry) {
+  if (size_t pos = locate(entry.first); pos != entries.size())
+    return {entries.begin() + pos, false};
+  entries.push_back(std::move(entry));
+  if (!index.empty())
+    index_entry(entries.size() - 1, JSONObjectHash{}(entries.back().first));
+  else if (entries.size() > linear_limit)
+    rebuild_index();
+  return {entries.end() - 1, true};
+}
+
+std::pair<JSONDict::iterator, bool> JSONDict::insert_or_assign(
+    JSONObject key, JSONObject value) {
+  if (size_t pos = locate(key); pos != entries.size()) {
+    entries[pos].second = std::move(value);
+    return {entries.begin() + pos, false};
+  }
+  return insert({std::move(key), std::move(value)});
+}
+
+JSONObject &JSONDict::operator[](JSONObject key) {
+  if (size_t pos = locate(key); pos != entries.size())
+    return entries[pos].second;
+  return insert({std::move(key), JSONObject{}}).first->second;
+}
+
+size_t JSONDict::erase(const JSONObject &key) {
+  size_t pos = locate(key);
+  if (pos == entries.size()) return 0;
+  // [note]: keeps the insertion order, positions shift so reindex
+  entries.erase(entries.begin() + pos);
+  if (!index.empty()) rebuild_index();
+  return 1;
+}
+
+JSONDict::iterator JSONDict::find(const JSONObject &key) {
+  return entries.begin() + locate(key);
+}
+
+JSONDict::const_iterator JSONDict::find(const JSONObject &key) const {
+  return entries.begin() + locate(key);
+}
+
+JSONDict::iterator JSONDict::find(std::string_view key) {
+  return entries.begin() + locate(key);
+}
+
+JSONDict::const_iterator JSONDict::find(std::string_view key) const {
+  return entries.begin() + locate(key);
+}
+
+JSONDict::iterator JSONDict::find(std::string_view key, size_t hash) {
+  return entries.begin() + locate(key, hash);
+}
+
+JSONDict::const_iterator JSONDict::find(std::string_view key,
+                                        size_t hash) const {
+  return entries.begin() + locate(key, hash);
+}
+
+size_t JSONDict::count(const JSONObject &key) const {
+  return locate(key) != entries.size();
+}
+
+size_t JSONDict::count(std::string_view key) const {
+  return locate(key) != entries.size();
+}
+
+JSONObject &JSONDict::at(const JSONObject &key) {
+  if (auto it = find(key); it != end()) return it->second;
+  throw std::out_of_range{"JSONDict::at"};
+}
+
+const JSONObject &JSONDict::at(const JSONObject &key) const {
+  if (auto it = find(key); it != end()) return it->second;
+  throw std::out_of_range{"JSONDict::at"};
+}
+
+JSONObject &JSONDict::at(std::string_view key) {
+  if (auto it = find(key); it != end()) return it->second;
+  throw std::out_of_range{"JSONDict::at"};
+}
+
+const JSONObject &JSONDict::at(std::string_view key) const {
+  if (auto it = find(key); it != end()) return it->second;
+  throw std::out_of_range{"JSONDict::at"};
+}
+
+bool JSONDict::operator==(const JSONDict &other) const {
+  if (size() != other.size()) return false;
+  for (const auto &[key, value] : entries) {
+    auto it = other.find(key);
+    if (it == other.end() || !(it->second == value)) return false;
+  }
+  return true;
+}
+
+// [note]: moves the non-empty lists/dicts directly inside obj to `pending`
+static void detach_children(JSONObject &obj, std::vector<JSONObject> &pending) {
+  auto detach = [&](JSONObject &child) {
+    auto *list = std::get_if<JSONList>(&child.inner);
+    auto *dict = std::get_if<JSONDict>(&child.inner);
+    if ((list && !list->empty()) || (dict && !dict->empty()))
+      pending.push_back(std::move(child));
+  };
+  if (auto *list = std::get_if<JSONList>(&obj.inner)) {
+    for (auto &element : *list) detach(element);
+  } else if (auto *dict = std::get_if<JSONDict>(&obj.inner)) {
+    for (auto &[key, value] : *dict) {
+      // [note]: a key is never modified in place, but the dict is going away
+      detach(const_cast<JSONObject &>(key));
+      detach(value);
+    }
+  }
+}
+
+JSONObject::~JSONObject() {
+  // [note]: each container taken from `pending` gives up its own nested
+  // containers before it is destroyed, so no destructor below this one has
+  // any left to recurse into, `pending` stays unallocated for a flat value
+  std::vector<JSONObject> pending;
+  detach_children(*this, pending);
+  while (!pending.empty()) {
+    JSONObject obj = std::move(pending.back());
+    pending.pop_back();
+    detach_children(obj, pending);
+  }
+}
+
+JSONObject share(JSONObject obj) {
+  if (!std::holds_alternative<JSONList>(obj.inner) &&
+      !std::holds_alternative<JSONDict>(obj.inner))
+    return obj;
+  return JSONObject{std::make_shared<JSONSharedNode>(std::move(obj))};
+}
+
+JSONObject &unshare(JSONObject &obj) {
+  if (auto *shared = std::get_if<JSONShared>(&obj.inner)) {
+    // [note]: share() made the content non-const, so it may be moved from
+    // once this is the last reference
+    JSONShared content = std::move(*shared);
+    if (content.use_count() == 1)
+      obj = std::move(const_cast<JSONSharedNode &>(*content).value);
+    else
+      obj = content->value;
+  }
+  return obj;
 }
 
 std::string anti_escape(char c) {
@@ -64,6 +257,9 @@ std::string anti_escape(char c) {
  *
  * other methods: sscanf, std::istringstream, need a buffer or temp variable,
  * and have performance loss
+ *
+ * std::stoi/std::stod may throw and depend on the current locale, so numbers
+ * are now converted by std::from_chars in scan_number (scanner.cpp)
  */
 template <typename T>
 std::optional<T> try_parse_num(
@@ -72,164 +268,56 @@ std::optional<T> try_parse_num(
                 // because we assume that a number string won't be too long and
                 // std::string has a small sequence optimization
   static_assert(std::is_same_v<T, int> || std::is_same_v<T, double>);
-  size_t end_loc{};
-  T value;
-  if constexpr (std::is_same_v<T, int>)
-    value = std::stoi(str, &end_loc);
-  else if constexpr (std::is_same_v<T, double>)
-    value = std::stod(str, &end_loc);
-  if (end_loc != str.size()) return std::nullopt;
-  return value;
+  NumberToken token = scan_number(str);
+  if (token.eaten != str.size()) return std::nullopt;
+  if constexpr (std::is_same_v<T, int>) {
+    if (!token.is_int) return std::nullopt;
+    return token.int_value;
+  } else {
+    return token.is_int ? token.int_value : token.double_value;
+  }
 }
 
-/*
- * strict JSON number: -?(0|[1-9]+[0-9]*)(\.[0-9]*)?([eE][+-]?[0-9]+)?
- * compatible with '+', '.' and zeros prefix
- * so the regex is [+-]?[0-9]+(\.[0-9]*)?([eE][+-]?[0-9]+)?
- */
-std::pair<JSONObject, size_t> parse_detail(std::string_view json) {
-  static constexpr std::string_view spaces = " \f\n\r\t\v";
-  if (json.empty()) {
-    return {JSONObject{std::monostate{}}, 0};
-  } else if (size_t prefix = json.find_first_not_of(spaces);
-             prefix != 0 && prefix != std::string_view::npos) {
-    auto [obj, eaten] = parse_detail(json.substr(prefix));
-    return {
-        JSONObject{std::move(obj)},
-        eaten + prefix};  // [note]: unified management of empty prefixes, no
-                          // need to compensate prefix in every return statement
-  } else if (json.substr(0, 4) == "null") {
-    return {JSONObject{std::monostate{}}, 4};
-  } else if (json.substr(0, 4) == "true") {
-    return {JSONObject{true}, 4};
-  } else if (json.substr(0, 5) == "false") {
-    return {JSONObject{false}, 5};
-  } else if (json.find_first_of("0123456789+-.") == 0) {
-    static thread_local const std::regex num_re{
-        R"([+-]?[0-9]+(\.[0-9]*)?([eE][+-]?[0-9]+)?)"};
-    std::cmatch match;
-    if (std::regex_search(json.begin(), json.end(), match, num_re)) {
-      std::string str = match.str();
-      if (auto num = try_parse_num<int>(str)) {
-        return {JSONObject{*num}, str.size()};
-      }
-      if (auto num = try_parse_num<double>(str)) {
-        return {JSONObject{*num}, str.size()};
-      }
-    }
-  } else if (char quote = json[0]; quote == '"' || quote == '\'') {
-    std::string str;
-    std::string_view::iterator itor;
-    enum { Raw, Escaped, Codecvt } phase = Raw;
-    char hex_value{};
-    for (itor = json.begin() + 1; itor != json.end(); ++itor) {
-      char ch = *itor;
-      if (phase == Raw) {
-        if (ch == '\\')
-          phase = Escaped;
-        else if (ch == quote)
-          break;
-        else
-          str += ch;
-      } else if (phase == Escaped) {
-        if (char escaped = basic_escape(ch); escaped != ch) {
-          str += escaped;
-          phase = Raw;
-        } else {
-          --itor;
-          phase = Codecvt;
-        }
-      } else if (phase == Codecvt) {
-        static thread_local Converter cvt;
-        if (auto result = cvt.deal(ch)) {
-          str += *result;
-          phase = Raw;
-          cvt.reset();
-        }
-      }
-    }
-    return {JSONObject{std::move(str)}, itor - json.begin() + 1};
-  } else if (json[0] == '[') {
-    JSONList list;
-    size_t whole_eaten = 1;
-    for (; whole_eaten < json.size();) {
-      if (json[whole_eaten] == ']') {
-        whole_eaten += 1;
-        break;
-      }
-      auto [obj, eaten] = parse_detail(json.substr(whole_eaten));
-      if (eaten == 0) {
-        whole_eaten = 0;
-        break;
-      }
-      list.emplace_back(obj);
-      whole_eaten += eaten;
-      while (spaces.find(json[whole_eaten]) != std::string_view::npos)
-        ++whole_eaten;
-      if (json[whole_eaten] == ',')
-        whole_eaten += 1;
-      else if (json[whole_eaten] != ']') {
-        whole_eaten = 0;
-        break;
-      }
-    }
-    LOG("list eaten: %u", whole_eaten);
-    return {JSONObject{std::move(list)}, whole_eaten};
-  } else if (json[0] == '{') {
-    JSONDict dict;
-    size_t whole_eaten = 1;
-    for (; whole_eaten < json.size();) {
-      if (json[whole_eaten] == '}') {
-        whole_eaten += 1;
-        break;
-      }
-      auto [key, k_eaten] = parse_detail(json.substr(whole_eaten));
-      if (k_eaten == 0) {
-        whole_eaten = 0;
-        break;
-      }
-      whole_eaten += k_eaten;
-      while (spaces.find(json[whole_eaten]) != std::string_view::npos)
-        ++whole_eaten;
-      if (json[whole_eaten] == ':')
-        whole_eaten += 1;
-      else {
-        whole_eaten = 0;
-        break;
-      }
-      auto [value, v_eaten] = parse_detail(json.substr(whole_eaten));
-      if (v_eaten == 0) {
-        whole_eaten = 0;
-        break;
-      }
-      dict.insert_or_assign(key, value);
-      whole_eaten += v_eaten;
-      while (spaces.find(json[whole_eaten]) != std::string_view::npos)
-        ++whole_eaten;
-      if (json[whole_eaten] == ',')
-        whole_eaten += 1;
-      else if (json[whole_eaten] != ']') {
-        whole_eaten = 0;
-        break;
-      }
-    }
-    LOG("dict eaten: %u", whole_eaten);
-    return {JSONObject{std::move(dict)}, whole_eaten};
-  }
-  return {JSONObject{std::monostate{}}, 0};
+// [note]: explicit instantiation since the template is defined in this
+// translation unit only
+template std::optional<int> try_parse_num<int>(std::string str);
+template std::optional<double> try_parse_num<double>(std::string str);
+
+template <typename Policy>
+std::pair<JSONObject, size_t> parse_detail(std::string_view json,
+                                           const ParseOptions &options) {
+  JSONObjectBuilder builder{options.stats};
+  size_t eaten = parse_sax<Policy>(json, builder, options);
+  return {builder.finish(), eaten};
 }
 
-JSONObject parse(std::string_view json) {
-  JSONObject result;
-  std::tie(result, std::ignore) = parse_detail(json);
-  return result;
+template <typename Policy>
+JSONObject parse(std::string_view json, const ParseOptions &options) {
+  return parse_detail<Policy>(json, options).first;
 }
 
+template std::pair<JSONObject, size_t> parse_detail<LenientPolicy>(
+    std::string_view json, const ParseOptions &options);
+template std::pair<JSONObject, size_t> parse_detail<StrictPolicy>(
+    std::string_view json, const ParseOptions &options);
+template JSONObject parse<LenientPolicy>(std::string_view json,
+                                         const ParseOptions &options);
+template JSONObject parse<StrictPolicy>(std::string_view json,
+                                        const ParseOptions &options);
+
 std::ostream &operator<<(std::ostream &os, const JSONObject &obj) {
-  // [note]: in c++23 we won't need to explicitly add a 'self' argument for
-  // recursive call
-  auto formatter = [&](auto &self, const JSONObject &obj,
-                       bool as_key = false) -> void {
+  // [note]: the open containers and how many of their children are printed,
+  // an explicit stack like the parser's, so a tree of any depth prints
+  struct Frame {
+    const JSONObject *container;
+    size_t next;
+  };
+  std::vector<Frame> stack;
+  // [note]: prints a scalar or an empty container whole and opens any other
+  // container, dict keys are printed flat, [...] and {...} standing for the
+  // content of a list/dict key
+  auto print = [&](const JSONObject &target, bool as_key) {
+    const JSONObject &obj = resolve(target);
     std::visit(overloaded{[&](std::monostate) { os << "null"; },
                           [&](bool b) { os << std::boolalpha << b; },
                           [&](int i) { os << i; }, [&](double d) { os << d; },
@@ -243,35 +331,50 @@ std::ostream &operator<<(std::ostream &os, const JSONObject &obj) {
                               os << std::quoted(s);
                           },
                           [&](const JSONList &list) {
-                            os << "[";
-                            if (!as_key) {
-                              size_t loc{};
-                              for (const auto &element : list) {
-                                self(self, element);
-                                os << (++loc == list.size() ? "" : ", ");
-                              }
-                            } else if (!list.empty()) {
-                              os << "...";
+                            if (list.empty() || as_key) {
+                              os << (list.empty() ? "[]" : "[...]");
+                              return;
                             }
-                            os << "]";
+                            os << "[";
+                            stack.push_back({&obj, 0});
                           },
                           [&](const JSONDict &dict) {
-                            os << "{";
-                            if (!as_key) {
-                              size_t loc{};
-                              for (const auto &[key, value] : dict) {
-                                self(self, key, true);
-                                os << ": ";
-                                self(self, value);
-                                os << (++loc == dict.size() ? "" : ", ");
-                              }
-                            } else if (!dict.empty()) {
-                              os << "...";
+                            if (dict.empty() || as_key) {
+                              os << (dict.empty() ? "{}" : "{...}");
+                              return;
                             }
-                            os << "}";
-                          }},
+                            os << "{";
+                            stack.push_back({&obj, 0});
+                          },
+                          [](const JSONShared &) {}},  // resolved above
                obj.inner);
   };
-  formatter(formatter, obj);
+  print(obj, false);
+  while (!stack.empty()) {
+    // [note]: print() may grow the stack, so `next` is advanced before
+    const JSONObject &container = *stack.back().container;
+    const size_t next = stack.back().next++;
+    if (auto *list = std::get_if<JSONList>(&container.inner)) {
+      if (next == list->size()) {
+        os << "]";
+        stack.pop_back();
+        continue;
+      }
+      if (next) os << ", ";
+      print((*list)[next], false);
+    } else {
+      const JSONDict &dict = std::get<JSONDict>(container.inner);
+      if (next == dict.size()) {
+        os << "}";
+        stack.pop_back();
+        continue;
+      }
+      if (next) os << ", ";
+      const auto &[key, value] = *(dict.begin() + next);
+      print(key, true);
+      os << ": ";
+      print(value, false);
+    }
+  }
   return os;
 }
\ No newline at end of file
@@ -1,19 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
 #include <iomanip>
 #include <iterator>
+#include <memory>
 #include <optional>
-#include <regex>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include "parser.h"
 #include "type.h"
 
 struct JSONObject;
+struct JSONSharedNode;
 
 // [note]: forward declaration of JSONObject's hash function to avoid imcomplete
 // type, as JSONObject definition itself relying on JSONDict's hash function
@@ -21,8 +26,114 @@ struct JSONObjectHash {
   inline size_t operator()(const JSONObject &obj) const;
 };
 
+/*
+ * [note]: the hashes of JSONObjectHash are built from these two, unlike
+ * std::hash they are the same on every run and build (of a little-endian
+ * target), so they may key caches kept outside the process
+ * hash_string is MurmurHash64A with a fixed seed, hash_mix the splitmix64
+ * finalizer
+ */
+inline uint64_t hash_string(std::string_view s) {
+  constexpr uint64_t m = 0xc6a4a7935bd1e995;
+  uint64_t h = 0x8445d61a4e774912 ^ (s.size() * m);
+  const char *p = s.data();
+  for (size_t n = s.size() / 8; n; --n, p += 8) {
+    uint64_t k;
+    std::memcpy(&k, p, 8);
+    k *= m;
+    k ^= k >> 47;
+    k *= m;
+    h = (h ^ k) * m;
+  }
+  if (size_t rest = s.size() % 8) {
+    uint64_t k = 0;
+    std::memcpy(&k, p, rest);
+    h = (h ^ k) * m;
+  }
+  h ^= h >> 47;
+  h *= m;
+  return h ^ (h >> 47);
+}
+
+constexpr uint64_t hash_mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
 using JSONList = std::vector<JSONObject>;
-using JSONDict = std::unordered_map<JSONObject, JSONObject, JSONObjectHash>;
+// [note]: an immutable list/dict shared by reference counting, see share()
+using JSONShared = std::shared_ptr<const JSONSharedNode>;
+
+/*
+ * [note]: a flat dict, entries are stored contiguously in insertion order so
+ * iterating and printing follow the source, small dicts are searched linearly
+ * and once a dict outgrows linear_limit a compact open addressing index of
+ * (entry, hash) slots is built and kept up to date by later insertions
+ * unlike std::unordered_map, insertions invalidate iterators and references,
+ * and keys must not be modified through an iterator
+ */
+class JSONDict {
+ public:
+  using value_type = std::pair<JSONObject, JSONObject>;
+  using iterator = std::vector<value_type>::iterator;
+  using const_iterator = std::vector<value_type>::const_iterator;
+  static constexpr size_t linear_limit = 8;
+
+  JSONDict() = default;
+  JSONDict(std::initializer_list<value_type> init);
+
+  iterator begin() { return entries.begin(); }
+  iterator end() { return entries.end(); }
+  const_iterator begin() const { return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+  size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+  void reserve(size_t n) { entries.reserve(n); }
+  size_t capacity() const { return entries.capacity(); }
+  void clear();
+
+  std::pair<iterator, bool> insert(value_type entry);
+  std::pair<iterator, bool> insert_or_assign(JSONObject key, JSONObject value);
+  JSONObject &operator[](JSONObject key);
+  size_t erase(const JSONObject &key);
+
+  iterator find(const JSONObject &key);
+  const_iterator find(const JSONObject &key) const;
+  // [note]: string key fast path, no JSONObject is built for the lookup
+  iterator find(std::string_view key);
+  const_iterator find(std::string_view key) const;
+  // [note]: with the key's hash computed beforehand, which must be
+  // hash_string(key), e.g. by a compiled JSONPath
+  iterator find(std::string_view key, size_t hash);
+  const_iterator find(std::string_view key, size_t hash) const;
+  size_t count(const JSONObject &key) const;
+  size_t count(std::string_view key) const;
+  JSONObject &at(const JSONObject &key);
+  const JSONObject &at(const JSONObject &key) const;
+  JSONObject &at(std::string_view key);
+  const JSONObject &at(std::string_view key) const;
+
+  // [note]: same entries regardless of order, as std::unordered_map does
+  bool operator==(const JSONDict &other) const;
+  bool operator!=(const JSONDict &other) const { return !(*this == other); }
+
+ private:
+  struct Slot {
+    uint32_t entry;  // position in entries + 1, 0 for an empty slot
+    uint32_t hash;   // low bits of the key's hash, to skip most comparisons
+  };
+  std::vector<value_type> entries;
+  std::vector<Slot> index;
+
+  template <typename Equal>
+  size_t locate(size_t hash, Equal equal) const;
+  size_t locate(const JSONObject &key) const;
+  size_t locate(std::string_view key) const;
+  size_t locate(std::string_view key, size_t hash) const;
+  void index_entry(size_t pos, size_t hash);
+  void rebuild_index();
+};
 
 struct JSONObject {
   std::variant<std::monostate,  // null
@@ -31,32 +142,121 @@ struct JSONObject {
                double,          // 3.14
                std::string,     // "hello"
                JSONList,        // [42, "hello"]
-               JSONDict         // {"hello": 985, "world": 211}
+               JSONDict,        // {"hello": 985, "world": 211}
+               JSONShared       // one of the two above, shared
                >
       inner;  // [note]: use struct wrapping std::variant to enable self nested
               // in std::variant declaration
 
-  bool operator==(const JSONObject &other) const {
-    return this->inner == other.inner;  // [note]: use std::variant::operator==
-  }
+  // [note]: defaulted, so JSONObject stays an aggregate, only declared since
+  // the destructor is
+  JSONObject() = default;
+  JSONObject(const JSONObject &) = default;
+  JSONObject(JSONObject &&) = default;
+  JSONObject &operator=(const JSONObject &) = default;
+  JSONObject &operator=(JSONObject &&) = default;
+  // [note]: nested lists/dicts are torn down from an explicit stack rather
+  // than by one recursive destructor call per level, so any tree the parser
+  // builds can be freed
+  ~JSONObject();
+
+  // [note]: a shared subtree equals its content, two shared subtrees whose
+  // hashes are known to differ are unequal without a walk
+  inline bool operator==(const JSONObject &other) const;
 };
 
+// [note]: what a JSONShared points to, as the content never changes its hash
+// is computed once, by whichever thread needs it first, 0 standing for not
+// yet (a real 0 is only computed again)
+struct JSONSharedNode {
+  explicit JSONSharedNode(JSONObject value) : value{std::move(value)} {}
+  JSONObject value;
+  mutable std::atomic<size_t> hash{0};
+};
+
+/*
+ * [note]: copy-on-write mode, share() moves a list/dict into a JSONShared so
+ * that copying the result, e.g. using it as several dict keys or embedding it
+ * in several trees, costs a reference count instead of a deep copy, anything
+ * else is returned as it is
+ * read it through resolve(), which gives any other object back unchanged, and
+ * call unshare() before modifying it: the content is moved out if nobody else
+ * holds it and copied otherwise
+ * equality, hashing, printing, serializing, binary encoding, JSONPath and
+ * JSONDocument all see through it, std::get<JSONList>(obj.inner) does not
+ */
+JSONObject share(JSONObject obj);
+inline const JSONObject &resolve(const JSONObject &obj) {
+  auto *shared = std::get_if<JSONShared>(&obj.inner);
+  return shared ? (*shared)->value : obj;
+}
+JSONObject &unshare(JSONObject &obj);
+
 size_t JSONObjectHash::operator()(const JSONObject &obj) const {
   // [note]: cannot use std::hash<std::variant> unless each element of
   // std::variant can be hashed, that is to say, we need to provide JSONList and
   // JSONDict's hash function
-  return std::visit(overloaded{
-                        [](const JSONList &list) {
-                          return std::hash<const JSONList *>{}(&list);
-                        },
-                        [](const JSONDict &dict) {
-                          return std::hash<const JSONDict *>{}(&dict);
-                        },
-                        [](auto basic) -> size_t {
-                          return std::hash<decltype(basic)>{}(basic);
-                        },
-                    },
-                    obj.inner);
+  // lists and dicts are hashed by content so that equal keys hash equally,
+  // dict entries are combined by addition as their order doesn't matter,
+  // scalars are mixed with their type so 1, 1.0 and true differ
+  auto combine = [](uint64_t seed, uint64_t hash) {
+    return seed ^ (hash + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+  };
+  auto scalar = [](uint64_t type, uint64_t bits) {
+    return hash_mix(bits ^ (type << 56));
+  };
+  return std::visit(
+      overloaded{
+          [&](std::monostate) { return scalar(0, 0); },
+          [&](bool b) { return scalar(1, b); },
+          [&](int i) { return scalar(2, static_cast<uint32_t>(i)); },
+          [&](double d) {
+            // [note]: -0.0 == 0.0, so they must hash the same
+            uint64_t bits = 0;
+            if (d != 0) std::memcpy(&bits, &d, sizeof bits);
+            return scalar(3, bits);
+          },
+          [](const std::string &s) {
+            // [note]: equals the hash of a std::string_view key, which the
+            // string key fast path relies on
+            return hash_string(s);
+          },
+          [&](const JSONList &list) {
+            uint64_t hash = scalar(5, list.size());
+            for (const auto &element : list)
+              hash = combine(hash, (*this)(element));
+            return hash;
+          },
+          [&](const JSONDict &dict) {
+            uint64_t hash = scalar(6, dict.size());
+            for (const auto &[key, value] : dict)
+              hash += combine((*this)(key), (*this)(value));
+            return hash;
+          },
+          [&](const JSONShared &shared) -> uint64_t {
+            size_t hash = shared->hash.load(std::memory_order_relaxed);
+            if (!hash) {
+              hash = (*this)(shared->value);
+              shared->hash.store(hash, std::memory_order_relaxed);
+            }
+            return hash;
+          },
+      },
+      obj.inner);
+}
+
+bool JSONObject::operator==(const JSONObject &other) const {
+  auto *lhs = std::get_if<JSONShared>(&inner);
+  auto *rhs = std::get_if<JSONShared>(&other.inner);
+  if (lhs && rhs) {
+    if (*lhs == *rhs) return true;
+    // [note]: computed once per shared subtree, so comparing the same ones
+    // again and again is O(1) unless they are equal
+    JSONObjectHash hash;
+    if (hash(*this) != hash(other)) return false;
+  }
+  // [note]: use std::variant::operator==
+  return resolve(*this).inner == resolve(other).inner;
 }
 
 std::ostream &operator<<(std::ostream &os, const JSONObject &obj);
@@ -64,6 +264,89 @@ std::ostream &operator<<(std::ostream &os, const JSONObject &obj);
 template <typename T>
 std::optional<T> try_parse_num(std::string str);
 
-std::pair<JSONObject, size_t> parse_detail(std::string_view json);
+/*
+ * [note]: builds the JSONObject tree from the events of parse_sax, containers
+ * under construction live on an explicit stack and each finished child is
+ * moved into its parent instead of being copied
+ */
+class JSONObjectBuilder {
+ public:
+  // [note]: stats receives the copied bytes and the allocations of the tree
+  explicit JSONObjectBuilder(ParseStats *stats = nullptr) : stats{stats} {}
+
+  void on_null() { add(JSONObject{std::monostate{}}); }
+  void on_bool(bool b) { add(JSONObject{b}); }
+  void on_int(int i) { add(JSONObject{i}); }
+  void on_double(double d) { add(JSONObject{d}); }
+  void on_string(std::string_view s) {
+    std::string str{s};
+    if (stats) {
+      stats->copied_bytes += s.size();
+      if (str.capacity() > std::string{}.capacity())
+        stats->add_allocation(str.capacity() + 1);
+    }
+    add(JSONObject{std::move(str)});
+  }
+  void on_key(std::string_view s) { on_string(s); }
+  void start_array() { stack.push_back({JSONObject{JSONList{}}, {}}); }
+  void end_array() { close(); }
+  void start_object() { stack.push_back({JSONObject{JSONDict{}}, {}}); }
+  void end_object() { close(); }
+  // [note]: adds an already built value where the next event would go
+  void on_value(JSONObject &&value) { add(std::move(value)); }
+
+  // [note]: containers left open by a bad format are kept as they are, so
+  // parse("[1, 2") still gives [1, 2]
+  JSONObject finish() {
+    while (!stack.empty()) close();
+    return std::move(result);
+  }
+
+ private:
+  struct Frame {
+    JSONObject container;
+    std::optional<JSONObject> key;  // a dict key waiting for its value
+  };
+  std::vector<Frame> stack;
+  JSONObject result;
+  ParseStats *stats;
+
+  void close() {
+    JSONObject container = std::move(stack.back().container);
+    stack.pop_back();
+    add(std::move(container));
+  }
+
+  void add(JSONObject &&value) {
+    if (stack.empty()) {
+      result = std::move(value);
+      return;
+    }
+    Frame &top = stack.back();
+    if (auto *list = std::get_if<JSONList>(&top.container.inner)) {
+      const size_t capacity = list->capacity();
+      list->push_back(std::move(value));
+      if (stats && list->capacity() != capacity)
+        stats->add_allocation(list->capacity() * sizeof(JSONObject));
+    } else if (!top.key) {
+      top.key = std::move(value);
+    } else {
+      JSONDict &dict = std::get<JSONDict>(top.container.inner);
+      const size_t capacity = dict.capacity();
+      dict.insert_or_assign(std::move(*top.key), std::move(value));
+      if (stats && dict.capacity() != capacity)
+        stats->add_allocation(dict.capacity() * sizeof(JSONDict::value_type));
+      top.key.reset();
+    }
+  }
+};
+
+// [note]: returns the parsed object with the characters eaten, 0 eaten
+// indicates a bad format and the object holds what was parsed before the error
+// (see ParseOptions::error), parse_detail<StrictPolicy> accepts RFC 8259 only
+template <typename Policy = LenientPolicy>
+std::pair<JSONObject, size_t> parse_detail(std::string_view json,
+                                           const ParseOptions &options = {});
 
-JSONObject parse(std::string_view json);
\ No newline at end of file
+template <typename Policy = LenientPolicy>
+JSONObject parse(std::string_view json, const ParseOptions &options = {});
\ No newline at end of file
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parser.h"
+#include "scanner.h"
+#include "simpleJSON.h"
+
+/*
+ * [note]: push-style parser, input is fed in chunks of any size (socket reads,
+ * file blocks...) and the handler receives the same events as from parse_sax
+ * as soon as they are complete (a handler returning false stops it like a bad
+ * format), a token split between chunks (a string with a
+ * half-read 我, a number, a literal) is kept in `token` until its end
+ * arrives, so memory is bounded by the longest token and the nesting depth
+ * instead of the input size
+ *
+ * the input may hold several top-level values one after another (e.g.
+ * newline-delimited records), the lenient compatibilities of parse_sax are
+ * kept, and a top-level number is only complete once a delimiter or finish()
+ * is seen
+ */
+template <typename Handler>
+class JSONStreamParser {
+ public:
+  explicit JSONStreamParser(Handler &handler, const ParseOptions &options = {})
+      : handler{handler}, options{options} {}
+
+  // [note]: returns false once the input turned out to be a bad format
+  bool feed(std::string_view chunk) {
+    size_t pos = 0;
+    while (pos < chunk.size() && state != State::Error) {
+      if (state == State::String)
+        pos = continue_string(chunk, pos, pos);
+      else if (state == State::Word)
+        pos = continue_word(chunk, pos, pos);
+      else
+        pos = structural(chunk, pos);
+    }
+    if (state != State::Error) offset += chunk.size();
+    return state != State::Error;
+  }
+
+  // [note]: the end of input, flushes a pending number or literal and returns
+  // whether every value was complete
+  bool finish() {
+    if (state == State::Word) {
+      std::string word = std::move(token);
+      token.clear();
+      emit_word(word, 0);
+    }
+    return state != State::Error && state != State::String && stack.empty();
+  }
+
+  bool failed() const { return state == State::Error; }
+  // [note]: bytes accepted so far, the position of the bad format when failed
+  size_t consumed() const { return offset; }
+  size_t depth() const { return stack.size(); }
+
+ private:
+  // [note]: Dict means a key is expected, Entry a value after the ':'
+  enum class Frame : char { List, Dict, Entry };
+  enum class State : char { Value, AfterValue, String, Word, Error };
+
+  Handler &handler;
+  ParseOptions options;
+  std::vector<Frame> stack;
+  State state = State::Value;
+  std::string token;   // the part of a token seen in previous chunks
+  std::string buffer;  // decoded string scratch for scan_string
+  char quote = '"';
+  bool escaped = false;  // a string chunk ended right after a '\\'
+  size_t offset = 0;
+
+  size_t fail(size_t pos) {
+    state = State::Error;
+    offset += pos;
+    return pos;
+  }
+
+  size_t structural(std::string_view chunk, size_t pos) {
+    pos = skip_spaces(chunk, pos);
+    if (pos == chunk.size()) return pos;
+    const char c = chunk[pos];
+    const Frame top = stack.empty() ? Frame::List : stack.back();
+    if (state == State::Value) {
+      if (!stack.empty() && c == ',' && top != Frame::Dict) {
+        if (!sax_emit([&] { return handler.on_null(); })) return fail(pos);
+        state = State::AfterValue;
+        return pos;
+      }
+      if (!stack.empty() && c == (top == Frame::List ? ']' : '}') &&
+          top != Frame::Entry)
+        return close(top) ? pos + 1 : fail(pos);
+      if (c == '[' || c == '{') {
+        if (stack.size() >= options.max_depth) return fail(pos);
+        bool go;
+        if (c == '[') {
+          stack.push_back(Frame::List);
+          go = sax_emit([&] { return handler.start_array(); });
+        } else {
+          stack.push_back(Frame::Dict);
+          go = sax_emit([&] { return handler.start_object(); });
+        }
+        return go ? pos + 1 : fail(pos);
+      }
+      if (c == '"' || c == '\'') {
+        quote = c;
+        state = State::String;
+        return continue_string(chunk, pos + 1, pos);
+      }
+      if (is_word(c)) {
+        state = State::Word;
+        return continue_word(chunk, pos, pos);
+      }
+      return fail(pos);
+    }
+    // [note]: State::AfterValue
+    if (stack.empty()) {
+      state = State::Value;  // the next top-level value
+      return pos;
+    }
+    if (top == Frame::Dict) {
+      if (c != ':') return fail(pos);
+      stack.back() = Frame::Entry;
+      state = State::Value;
+      return pos + 1;
+    }
+    if (c == ',') {
+      if (top == Frame::Entry) stack.back() = Frame::Dict;
+      state = State::Value;
+      return pos + 1;
+    }
+    if (c != (top == Frame::List ? ']' : '}')) return fail(pos);
+    return close(top) ? pos + 1 : fail(pos);
+  }
+
+  // [note]: false if the handler stops the parse
+  bool close(Frame top) {
+    stack.pop_back();
+    state = State::AfterValue;
+    if (top == Frame::List)
+      return sax_emit([&] { return handler.end_array(); });
+    return sax_emit([&] { return handler.end_object(); });
+  }
+
+  // [note]: scans from pos, `begin` is where the token starts in this chunk
+  size_t continue_string(std::string_view chunk, size_t pos, size_t begin) {
+    const size_t size = chunk.size();
+    if (escaped && pos < size) {
+      escaped = false;
+      ++pos;
+    }
+    for (;;) {
+      pos = find_quote_or_escape(chunk, pos, quote);
+      if (pos < size && chunk[pos] == '\\' && pos + 1 < size) {
+        pos += 2;
+        continue;
+      }
+      if (pos == size || chunk[pos] == '\\') {
+        escaped = pos != size;
+        token.append(chunk.data() + begin, size - begin);
+        return size;
+      }
+      break;
+    }
+    std::string_view raw = chunk.substr(begin, pos + 1 - begin);
+    if (!token.empty()) {
+      token.append(raw);
+      raw = token;
+    }
+    StringToken str = scan_string(raw, buffer, options.escape_extensions);
+    if (str.eaten != raw.size()) return fail(pos);
+    bool go;
+    if (!stack.empty() && stack.back() == Frame::Dict)
+      go = sax_emit([&] { return handler.on_key(str.value); });
+    else
+      go = sax_emit([&] { return handler.on_string(str.value); });
+    token.clear();
+    if (!go) return fail(pos);
+    state = State::AfterValue;
+    return pos + 1;
+  }
+
+  size_t continue_word(std::string_view chunk, size_t pos, size_t begin) {
+    const size_t size = chunk.size();
+    while (pos < size && is_word(chunk[pos])) ++pos;
+    if (pos == size) {
+      token.append(chunk.data() + begin, size - begin);
+      return size;
+    }
+    std::string_view word = chunk.substr(begin, pos - begin);
+    if (!token.empty()) {
+      token.append(word);
+      word = token;
+    }
+    emit_word(word, pos);
+    token.clear();
+    return pos;
+  }
+
+  // [note]: like parse_sax, a valid prefix is still reported before failing
+  void emit_word(std::string_view word, size_t pos) {
+    size_t eaten = 0;
+    bool go = true;
+    if (word.substr(0, 4) == "null") {
+      go = sax_emit([&] { return handler.on_null(); });
+      eaten = 4;
+    } else if (word.substr(0, 4) == "true") {
+      go = sax_emit([&] { return handler.on_bool(true); });
+      eaten = 4;
+    } else if (word.substr(0, 5) == "false") {
+      go = sax_emit([&] { return handler.on_bool(false); });
+      eaten = 5;
+    } else if (NumberToken num = scan_number(word); num.eaten) {
+      if (num.is_int)
+        go = sax_emit([&] { return handler.on_int(num.int_value); });
+      else
+        go = sax_emit([&] { return handler.on_double(num.double_value); });
+      eaten = num.eaten;
+    }
+    if (!go || eaten != word.size()) {
+      fail(pos);
+      return;
+    }
+    state = State::AfterValue;
+  }
+};
+
+/*
+ * [note]: a handler for JSONStreamParser building JSONObjects, every value
+ * completed at `emit_depth` is moved to the callback and not kept anywhere,
+ * depth 0 gives whole top-level values, depth 1 gives the elements of a huge
+ * top-level list one by one (inside a dict, keys and values come alternately)
+ */
+class JSONValueEmitter {
+ public:
+  explicit JSONValueEmitter(std::function<void(JSONObject &&)> on_value,
+                            size_t emit_depth = 0)
+      : callback{std::move(on_value)}, emit_depth{emit_depth} {}
+
+  void on_null() { scalar(JSONObject{std::monostate{}}); }
+  void on_bool(bool b) { scalar(JSONObject{b}); }
+  void on_int(int i) { scalar(JSONObject{i}); }
+  void on_double(double d) { scalar(JSONObject{d}); }
+  void on_string(std::string_view s) { scalar(JSONObject{std::string{s}}); }
+  void on_key(std::string_view s) { on_string(s); }
+  void start_array() {
+    if (depth++ >= emit_depth) builder.start_array();
+  }
+  void end_array() {
+    if (--depth >= emit_depth) builder.end_array();
+    if (depth == emit_depth) callback(builder.finish());
+  }
+  void start_object() {
+    if (depth++ >= emit_depth) builder.start_object();
+  }
+  void end_object() {
+    if (--depth >= emit_depth) builder.end_object();
+    if (depth == emit_depth) callback(builder.finish());
+  }
+
+ private:
+  std::function<void(JSONObject &&)> callback;
+  size_t emit_depth, depth = 0;
+  JSONObjectBuilder builder;
+
+  void scalar(JSONObject &&value) {
+    if (depth == emit_depth)
+      callback(std::move(value));
+    else if (depth > emit_depth)
+      builder.on_value(std::move(value));
+  }
+};
\ No newline at end of file
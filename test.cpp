@@ -1,7 +1,30 @@
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
 
+#include "binary.h"
+#include "binding.h"
+#include "document.h"
+#include "lazy.h"
+#include "ndjson.h"
+#include "parallel.h"
+#include "query.h"
+#include "serializer.h"
+#include "stream.h"
 #include "simpleJSON.h"
 
+// [note]: a struct bound to JSON, see the struct binding test
+struct Account {
+  std::string owner;
+  int64_t balance = 0;
+  std::vector<std::string> tags;
+  std::optional<double> rate;
+};
+JSON_FIELDS(Account, owner, balance, tags, rate)
+
 int main() {
   /*** basic test ***/
   // [note]: providing parse_detail interface to check if a parse is valid or
@@ -28,6 +51,11 @@ int main() {
     JSONObject result = parse(ds);
     std::cout << std::get<double>(result.inner) << '\n';
   }
+  // out of range numbers give inf or 0 like strtod, by their whole magnitude
+  std::string huge = std::string(400, '9') + "e-50",
+              tiny = "-0." + std::string(400, '0') + "1e50";
+  std::cout << parse(huge) << ' ' << parse(tiny) << ' ' << parse("1e400")
+            << ' ' << parse("-1e-400") << '\n';  // inf -0 inf -0
   for (auto ss :
        {R"("string")", R"("\"escaped\"\n")", R"("bad escaped format \g")"}) {
     JSONObject result = parse(ss);
@@ -49,6 +77,12 @@ int main() {
 "Alice\u000a": "\u6211\u7231\u4f60!",
 "Steve\U0000000a": "\U00004f60\U00007231\U00006211?"
 })") << '\n';
+  // surrogate pairs make one code point, \x and \ddd can be turned off
+  ParseOptions no_extensions;
+  no_extensions.escape_extensions = false;
+  std::cout << parse(R"(["\ud83d\ude00", "\ud83d?"])") << ' '
+            << parse(R"("\x41\101")", no_extensions) << '\n';
+  // ["😀", "�?"] "x41101"
   // test JSONObject as JSONDict' s key
   JSONObject wrap_dict{
       JSONDict{{{"introduction"}, {"use any JSONObject as dict's key"}},
@@ -57,6 +91,10 @@ int main() {
                {{JSONList{}}, {"empty list"}},
                {{JSONDict{}}, {"empty dict"}}}};
   std::cout << wrap_dict << '\n';
+  // string key fast path, and list/dict keys are looked up by content
+  const JSONDict &wrapped = std::get<JSONDict>(wrap_dict.inner);
+  std::cout << wrapped.at("introduction") << ' ' << wrapped.at(list)
+            << '\n';  // "use any JSONObject as dict's key" "list"
   /*** test bad formats compatibility ***/
   std::cout << "bad format1: " << parse("[1, 2,]") << '\n';   // [1, 2]
   std::cout << "bad format2: " << parse("[1, 2") << '\n';     // [1, 2]
@@ -69,4 +107,252 @@ int main() {
   std::cout << "bad format8: " << parse(R"([8, 8b, 12.7])") << '\n';  // [8, 8]
   std::cout << "bad format9: " << parse(R"([9, 5.7e3.6, 0])")
             << '\n';  // [9, 5700]
-}
\ No newline at end of file
+  /*** test strict mode ***/
+  // RFC 8259 only, bad formats fail with what and where went wrong
+  ParseError error;
+  ParseOptions report;
+  report.error = &error;
+  for (auto bad : {"[1, 2,]", "{'key': 1}", "[01]", "{\"a\": 1}\n}"}) {
+    parse_detail<StrictPolicy>(bad, report);
+    std::cout << describe(error.code) << " at " << error.line << ':'
+              << error.column << "; ";
+  }
+  std::cout << '\n';
+  // trailing comma at 1:7; expected a string key at 1:2; invalid number at 1:2;
+  // trailing characters at 2:1;
+  // validate() checks grammar and UTF-8 without building any value
+  std::cout << validate(R"({"a": [1, 2.5e3, "\u00e9"]})").ok() << ' '
+            << describe(validate("[\"\xff\"]").code) << '\n';
+  // true invalid UTF-8
+  /*** test nesting depth limit ***/
+  // [note]: the parser keeps its own container stack, deep input fails with 0
+  // eaten instead of overflowing the call stack
+  std::string deep = std::string(10000, '[') + std::string(10000, ']');
+  std::cout << "too deep: eaten=" << parse_detail(deep).second << '\n';  // 0
+  std::cout << "deep enough: eaten="
+            << parse_detail(deep, ParseOptions{10000}).second
+            << '\n';  // 20000
+  // [note]: printing and destroying the tree walk an explicit stack too
+  std::ostringstream deep_printed;
+  deep_printed << parse(deep, ParseOptions{10000});
+  std::cout << "deep printed back: " << (deep_printed.str() == deep)
+            << '\n';  // true
+  /*** test arena allocated document ***/
+  JSONDocument doc;
+  doc.parse(
+      R"({"name": "simpleJSON", "tags": ["json", "arena"], "stars": 42})");
+  JSONNodeDict fields = get<JSONNodeDict>(doc.root());
+  std::cout << get<std::string_view>(fields.at("name")) << ' '
+            << get<int>(fields.at("stars")) << ' '
+            << get<JSONNodeList>(fields.at("tags")).size()
+            << '\n';  // simpleJSON 42 2
+  // convert from and back to JSONObject
+  std::cout << (JSONDocument{dict}.to_object() == dict) << '\n';  // true
+  // zero-copy parse, unescaped strings view the input which must outlive doc
+  std::string input = R"(["view", "escaped\n"])";
+  doc.parse_view(input);
+  JSONNodeList strs = get<JSONNodeList>(doc.root());
+  std::cout << (get<std::string_view>(strs[0]).data() == &input[2]) << ' '
+            << (get<std::string_view>(strs[1]).data() == &input[10])
+            << '\n';  // true false
+  /*** test serializer ***/
+  // strict JSON: keys always quoted, doubles keep a '.', escapes in \uXXXX
+  std::cout << serialize(dict) << '\n';
+  std::cout << serialize(parse(R"([3.0, "\v", {"k": []}, {}])"),
+                         SerializeOptions{true})
+            << '\n';
+  /*** test streaming parser ***/
+  // chunks split a \u escape and a number, list elements are emitted one by one
+  JSONValueEmitter emitter{
+      [](JSONObject &&value) { std::cout << value << ' '; }, 1};
+  JSONStreamParser stream{emitter};
+  for (auto chunk : {R"([1, {"a": "\u62)", R"(11"}, 4)", "2]"})
+    stream.feed(chunk);
+  std::cout << stream.finish() << '\n';  // 1 {a: "我"} 42 true
+  /*** test SAX handler ***/
+  // aggregate without building a tree, returning false stops the parse
+  struct Summer : JSONHandler {
+    int keys = 0;
+    double sum = 0;
+    void on_key(std::string_view) { ++keys; }
+    void on_int(int i) { sum += i; }
+    void on_double(double d) { sum += d; }
+    bool start_object() { return keys < 3; }
+  } summer;
+  parse_sax(R"({"a": 1, "b": [2, 3.5], "c": {"d": 4}})", summer);
+  std::cout << summer.keys << ' ' << summer.sum << '\n';  // 3 6.5
+  /*** test NDJSON batch ***/
+  // results keep the input order, blank lines are skipped
+  auto records =
+      parse_ndjson("{\"id\": 1}\n\n[2, 3]\r\n{\"id\": \n4\n", {2, {}});
+  for (const auto &record : records)
+    std::cout << record.line << ':' << record.ok << ' ';
+  std::cout << records[1].value << '\n';  // 1:true 3:true 4:false 5:true [2, 3]
+  /*** test memory mapped file ***/
+  // the document keeps the mapping only while its strings view the file
+  std::ofstream{"mapped.json"} << R"({"file": "mapped", "size": 2})";
+  std::cout << parse_file("mapped.json") << ' '
+            << parse_file_detail("missing.json").second << '\n';
+  // {file: "mapped", size: 2} 0
+  doc.parse_file_view("mapped.json");
+  std::cout << get<std::string_view>(get<JSONNodeDict>(doc.root()).at("file"))
+            << ' ' << !doc.source().empty() << '\n';  // mapped true
+  // a slice of the mapped source can be parsed again, the mapping stays
+  doc.parse_view(doc.source().substr(9, 8));
+  std::cout << get<std::string_view>(doc.root()) << ' '
+            << !doc.source().empty() << '\n';  // mapped true
+  doc.parse_file("mapped.json");
+  std::cout << doc.source().empty() << '\n';  // true
+  std::remove("mapped.json");
+  /*** test path query ***/
+  // compiled once, evaluated on trees and documents alike
+  JSONObject order = parse(
+      R"({"user": {"name": "ingnaryk"}, "items": [{"id": 7}, {"id": 8}],
+          "a/b": {"~": 1}})");
+  auto name = JSONPath::compile("$.user.name");
+  auto second = JSONPath::from_pointer("/items/1/id");
+  std::cout << *name->find(order) << ' ' << *second->find(order) << ' '
+            << *JSONPath::from_pointer("/a~1b/~0")->find(order) << ' '
+            << (JSONPath::compile("$.items[2]")->find(order) == nullptr)
+            << ' ' << !JSONPath::compile("$.items[") << '\n';
+  // "ingnaryk" 8 1 true true
+  std::vector<const JSONNode *> ids;
+  doc = JSONDocument{order};
+  JSONPath::compile("$.items[*].id")->find_all(doc.root(), ids);
+  std::cout << ids.size() << ' ' << get<int>(*ids[0]) << '\n';  // 2 7
+  /*** test lazy cursor ***/
+  // only the values read are decoded, the others are skipped over
+  std::string_view lazy_json =
+      R"({"skipped": [{"deep": ["]", "}"]}], "items": [1, , 'three'],
+          "items": [4, 5]})";
+  JSONCursor cursor{lazy_json};
+  std::cout << cursor["items"].raw() << ' ' << cursor["items"][1].decode()
+            << ' ' << cursor["skipped"][0]["deep"].size() << ' '
+            << cursor["missing"][0].valid() << '\n';  // [4, 5] 5 2 false
+  /*** test binary encoding ***/
+  // round-trips exactly, containers can be skipped without decoding
+  std::string bytes = encode_binary(order);
+  std::cout << (decode_binary(bytes) == order) << ' '
+            << (skip_binary(bytes) == bytes.size()) << ' '
+            << decode_binary_detail(bytes.substr(0, 10)).second
+            << '\n';  // true true 0
+  // a container body over the limit, 4GB at most, fails the encoding and
+  // leaves the output as it was
+  JSONObject two_ints = parse("[1, 2]");  // a 4 bytes body
+  std::string limited;
+  std::cout << encode_binary(two_ints, limited, 4) << ' '
+            << encode_binary(two_ints, limited, 3) << ' ' << limited.size()
+            << '\n';  // true false 10
+  /*** test parse statistics ***/
+  // collected only when asked for, per parse or across several
+  ParseStats parse_stats;
+  ParseOptions with_stats;
+  with_stats.stats = &parse_stats;
+  std::string stats_json = R"({"list": [1, 2.5, "a\tb", [null]], "ok": true})";
+  parse(stats_json, with_stats);
+  std::cout << parse_stats.keys << ' ' << parse_stats.ints << ' '
+            << parse_stats.doubles << ' ' << parse_stats.lists << ' '
+            << parse_stats.max_depth << ' ' << parse_stats.escapes << ' '
+            << parse_stats.copied_bytes << '\n';  // 2 1 1 2 3 1 9
+  parse_stats = {};
+  doc.parse_view(stats_json, with_stats);
+  std::cout << parse_stats.viewed_bytes << ' ' << parse_stats.copied_bytes
+            << ' ' << parse_stats.allocations << '\n';  // 6 3 0
+  /*** test struct binding ***/
+  // read and written straight from the text, unknown keys are skipped
+  std::optional<Account> account = from_json<Account>(
+      R"({"owner": "ingnaryk", "history": [{"in": 1}], "balance": 5000000000,
+          "tags": ["vip"], "rate": null})");
+  std::cout << account->owner << ' ' << account->balance << ' '
+            << account->tags.size() << ' ' << account->rate.has_value()
+            << '\n';  // ingnaryk 5000000000 1 false
+  account->rate = 1.5;
+  std::cout << to_json(*account) << ' '
+            << !from_json<Account>(R"({"balance": "none"})") << '\n';
+  // {"owner":"ingnaryk","balance":5000000000,"tags":["vip"],"rate":1.5} true
+  // empty slots are null like in parse, which only an optional can hold
+  std::cout << from_json<std::vector<std::optional<int>>>("[1, , 2]")->size()
+            << ' ' << !from_json<std::vector<int>>("[1, , 2]") << ' '
+            << from_json<Account>(R"({"history": , "owner": "x"})")->owner
+            << '\n';  // 3 true x
+  // the value must be the whole input, spaces aside
+  std::cout << from_json<Account>(R"({"owner": "y"}  )").has_value() << ' '
+            << from_json<Account>(R"({"owner": "y"} garbage)").has_value()
+            << '\n';  // true false
+  // escapes are decoded like in parse, extensions included unless turned off
+  std::cout << *from_json<std::string>(R"("\x41")") << ' '
+            << *from_json<std::string>(R"("\x41")", no_extensions) << '\n';
+  // A x41
+  /*** test key interning ***/
+  // identical keys of every document parsed with the table share one copy
+  JSONKeyTable key_table;
+  ParseOptions interned;
+  interned.keys = &key_table;
+  JSONDocument users, more_users;
+  users.parse(R"([{"id": 1, "name": "a"}, {"id": 2, "name": "b"}])", interned);
+  more_users.parse(R"({"id": 3, "n\u0061me": "c"})", interned);
+  const JSONKey *name_key = key_table.find("name");
+  JSONNodeList user_list = get<JSONNodeList>(users.root());
+  std::cout << key_table.size() << ' '
+            << get<std::string_view>(
+                   *get<JSONNodeDict>(user_list[1]).find(*name_key))
+            << ' '
+            << get<std::string_view>(
+                   *get<JSONNodeDict>(more_users.root()).find(*name_key))
+            << '\n';  // 2 b c
+  /*** test shared subtrees ***/
+  // copies of a shared list/dict only count references, which are looked up,
+  // compared and printed as their content, unshare() before modifying one
+  JSONObject shared_list = share(list);
+  JSONObject shared_wrap{
+      JSONDict{{shared_list, {"list"}}, {{"copy"}, shared_list}}};
+  const JSONDict &shared_dict = std::get<JSONDict>(shared_wrap.inner);
+  std::cout << shared_dict.at(list) << ' '
+            << (shared_dict.at("copy") == list) << ' '
+            << std::get<JSONShared>(shared_list.inner).use_count()
+            << '\n';  // "list" true 3
+  std::get<JSONList>(unshare(shared_list).inner).push_back({true});
+  std::cout << std::get<JSONList>(shared_list.inner).size() << ' '
+            << std::get<JSONList>(resolve(shared_dict.at("copy")).inner).size()
+            << '\n';  // 6 5
+  // a path walks through shared values and finds what they share
+  std::cout << std::holds_alternative<JSONList>(
+                   JSONPath::compile("copy")->find(shared_wrap)->inner)
+            << '\n';  // true
+  /*** test structural hash ***/
+  // by content whatever the dict order, so equal payloads collapse, the hash
+  // of a shared subtree is computed once and rejects unequal ones right away
+  std::unordered_set<JSONObject, JSONObjectHash> payloads{
+      parse(R"({"id": [1, 2], "score": 0.0})"),
+      parse(R"({"score": -0.0, "id": [1, 2]})"),
+      share(parse(R"({"id": [1, 2], "score": 0})"))};
+  JSONObject one = share(parse("[1]")), two = share(parse("[2]"));
+  std::cout << payloads.size() << ' ' << (one == two) << ' '
+            << (JSONObjectHash{}(one) == JSONObjectHash{}(parse("[1]")))
+            << '\n';  // 2 false true
+  /*** test parallel parse ***/
+  // one document split across threads, same result as parse, a bad one is
+  // left to the sequential parse and fails just the same
+  ParallelOptions parallel;
+  parallel.threads = 4;
+  parallel.min_size = parallel.min_chunk = 1;  // split even a tiny input
+  std::string big = R"({"meta": {"n": 3}, "data": [{"id": 1}, "a,]", [2, 3]]})";
+  std::cout << (parse_parallel(big, parallel) == parse(big)) << ' '
+            << parse_parallel_detail(big, parallel).second << ' '
+            << parse_parallel_detail("[1, 2, {]", parallel).second
+            << '\n';  // true 54 0
+  /*** test parser context ***/
+  // a parser keeps its buffers from one parse to the next, so same-shaped
+  // documents after the first one need no allocation
+  JSONParser parser;
+  ParseStats reuse_stats;
+  ParseOptions counted;
+  counted.stats = &reuse_stats;
+  parser.parse(R"({"id": 1, "tags": ["a\tb", "c"]})", counted);
+  size_t held = parser.usage().total();
+  reuse_stats = {};
+  parser.parse(R"({"id": 2, "tags": ["d\te", "f"]})", counted);
+  std::cout << get<int>(get<JSONNodeDict>(parser.root()).at("id")) << ' '
+            << reuse_stats.allocations << ' '
+            << (parser.usage().total() == held) << '\n';  // 2 0 true
+}